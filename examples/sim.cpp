@@ -5,6 +5,8 @@
 #include <iostream>
 #include <bash_parameter3_msk.hpp>
 #include <sim_class.hpp>
+#include <chain_class.hpp>
+#include <replica_class.hpp>
 
 using namespace std;
 using namespace perimeter_rvb;
@@ -21,25 +23,56 @@ int main(int argc, char* argv[])
     p["L"] = 4;
     p["shift"] = "shift.txt";
     p["res"] = "results.txt";
+    p["mutual_res"] = "mutual.txt";
+    p["loop_hist_res"] = "loop_hist.txt";
+    p["corr_res"] = "corr.txt";
+    p["sf_res"] = "sf.txt";
+    p["dimer_sf_res"] = "dimer_sf.txt";
+    p["dimer_corr_res"] = "dimer_corr.txt";
+    p["snap_res"] = "snapshots.bin";
     p["timer_dest"] = 1;
 
     p.read(argc, argv);
     
-    p["term"] = p["mult"] * 100000;
-    p["sim"] = p["mult"] * 1000000;
+    p["term"] = p["mult"] * 100000; //only the maximum if -therm_auto is given
+    p["sim"] = p["mult"] * 1000000; //only the maximum if -target_error or -target_rel_error is given
     //~ p["H"] = p["L"];
     
     std::string prog_dir = p["prog_dir"];
     
     remove(std::string(prog_dir + std::string(p["res"])).c_str());
+    remove(std::string(prog_dir + std::string(p["mutual_res"])).c_str());
+    remove(std::string(prog_dir + std::string(p["loop_hist_res"])).c_str());
+    remove(std::string(prog_dir + std::string(p["corr_res"])).c_str());
+    remove(std::string(prog_dir + std::string(p["sf_res"])).c_str());
+    remove(std::string(prog_dir + std::string(p["dimer_sf_res"])).c_str());
+    remove(std::string(prog_dir + std::string(p["dimer_corr_res"])).c_str());
     
     p["shift"] = prog_dir + std::string(p["shift"]);
     p["res"] = prog_dir + std::string(p["res"]);
+    p["mutual_res"] = prog_dir + std::string(p["mutual_res"]);
+    p["loop_hist_res"] = prog_dir + std::string(p["loop_hist_res"]);
+    p["corr_res"] = prog_dir + std::string(p["corr_res"]);
+    p["sf_res"] = prog_dir + std::string(p["sf_res"]);
+    p["dimer_sf_res"] = prog_dir + std::string(p["dimer_sf_res"]);
+    p["dimer_corr_res"] = prog_dir + std::string(p["dimer_corr_res"]);
+    p["snap_res"] = prog_dir + std::string(p["snap_res"]);
     
     std::cout << p["shift"] << std::endl;
     
     addon::immortal.set_path(p["prog_dir"]);
     
+    if(p.get().count("chain")) { //-chain runs all increments of the shift file in this process
+        chain_class chain(p.get());
+        chain.run();
+        return 0;
+    }
+    if(p.get().count("replica")) { //-replica like -chain, but with exchanges between neighbouring links
+        replica_class replica(p.get());
+        replica.run();
+        return 0;
+    }
+    
     sim_class sim(p.get());
     
     sim.run();
@@ -0,0 +1,145 @@
+// Author:  Mario S. Könz <mskoenz@gmx.net>
+// Date:    19.10.2026 12:41:09 EDT
+// File:    accum_binning.hpp
+
+#ifndef __ACCUM_BINNING_HEADER
+#define __ACCUM_BINNING_HEADER
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+///  \brief accumulator with logarithmic binning
+///
+///  Level l holds the count, sum and sum of squares of the averages over 2^l consecutive samples, s.t.
+///  the memory is O(log n). The error estimate of level l grows with l as long as the bins are
+///  shorter than the autocorrelation time and stays constant (plateau) afterwards. error() uses the
+///  highest level with at least min_bins bins, converged() tells if the plateau is reached there.
+class accumulator_binning
+{
+    ///  \brief the statistics of one binning level
+    struct level_struct {
+        level_struct(): count(0), sum(0), sum2(0), pending(0), full(false) {
+        }
+        template<typename Archive>
+        void serialize(Archive & ar) {
+            ar & count;
+            ar & sum;
+            ar & sum2;
+            ar & pending;
+            ar & full;
+        }
+        uint64_t count; ///< amount of finished bins
+        double sum;     ///< sum of the bin averages
+        double sum2;    ///< sum of the squared bin averages
+        double pending; ///< the first half of the next bin on the level above
+        bool full;      ///< true if pending is used
+    };
+    public:
+        static unsigned const min_bins = 128; ///< a level needs at least this many bins to give an error
+
+        accumulator_binning(): level_(1) {
+        };
+        void operator<<(double const & val) {
+            double v = val;
+            for(unsigned l = 0; ; ++l) {
+                if(l == level_.size())
+                    level_.push_back(level_struct());
+                level_struct & lev = level_[l];
+                ++lev.count;
+                lev.sum += v;
+                lev.sum2 += v * v;
+                if(not lev.full) {
+                    lev.pending = v;
+                    lev.full = true;
+                    return;
+                }
+                v = (lev.pending + v) / 2;
+                lev.full = false;
+            }
+        }
+        ///  \brief adds the statistics of another accumulator (e.g. of a replica)
+        ///
+        ///  the bins of both are just pooled level by level, the pending half bins of other are dropped
+        void merge(accumulator_binning const & other) {
+            if(level_.size() < other.level_.size())
+                level_.resize(other.level_.size());
+            for(unsigned l = 0; l < other.level_.size(); ++l) {
+                level_[l].count += other.level_[l].count;
+                level_[l].sum += other.level_[l].sum;
+                level_[l].sum2 += other.level_[l].sum2;
+            }
+        }
+        uint64_t count() const {
+            return level_[0].count;
+        }
+        double sum() const {
+            return level_[0].sum;
+        }
+        double mean() const {
+            return level_[0].sum / level_[0].count;
+        }
+        ///  \brief standard deviation of the samples, 0 for fewer than 2 samples
+        double deviation() const {
+            using std::sqrt;
+            uint64_t const & n = level_[0].count;
+            if(n < 2)
+                return 0;
+            return sqrt(level_[0].sum2 / (n - 1) - level_[0].sum * level_[0].sum / n / (n - 1));
+        }
+        ///  \brief amount of levels with at least min_bins bins
+        unsigned levels() const {
+            unsigned l = 0;
+            while(l < level_.size() and level_[l].count >= min_bins)
+                ++l;
+            return l;
+        }
+        ///  \brief error of the mean if bins of size 2^l are taken as independent, 0 if the level has fewer than 2 bins
+        double error(unsigned const & l) const {
+            using std::sqrt;
+            if(l >= level_.size() or level_[l].count < 2)
+                return 0;
+            level_struct const & lev = level_[l];
+            double m = lev.sum / lev.count;
+            double var = lev.sum2 / lev.count - m * m;
+            return sqrt((var > 0 ? var : 0) / (lev.count - 1));
+        }
+        ///  \brief error of the highest level that has enough bins
+        double error() const {
+            unsigned l = levels();
+            return error(l == 0 ? 0 : l - 1);
+        }
+        ///  \brief integrated autocorrelation time in samples, from error() and the naive error
+        double tau() const {
+            double e0 = error(0);
+            double e = error();
+            return e0 > 0 ? (e * e / e0 / e0 - 1) / 2 : 0;
+        }
+        ///  \brief true if the errors of the two highest usable levels agree within the error of the error
+        bool converged() const {
+            unsigned l = levels();
+            if(l < 3)
+                return false;
+            double e = error(l - 1);
+            double e1 = error(l - 2);
+            return std::abs(e - e1) <= e * 2 / std::sqrt(2.0 * (level_[l - 1].count - 1));
+        }
+        void print(std::ostream & os) const {
+            os << mean();
+            os << "+/-";
+            os << error();
+        }
+        template<typename Archive>
+        void serialize(Archive & ar) {
+            ar & level_;
+        }
+    private:
+        std::vector<level_struct> level_; ///< level l has bins of size 2^l
+};
+
+std::ostream & operator<<(std::ostream & os, accumulator_binning const & acc) {
+    acc.print(os);
+    return os;
+}
+#endif //__ACCUM_BINNING_HEADER
@@ -0,0 +1,108 @@
+// Author:  Mario S. Könz <mskoenz@gmx.net>
+// Date:    19.10.2026 19:12:27 EDT
+// File:    accum_histogram.hpp
+
+#ifndef __ACCUM_HISTOGRAM_HEADER
+#define __ACCUM_HISTOGRAM_HEADER
+
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+
+///  \brief histogram of positive integers with exact bins for small and log-spaced bins for large values
+///
+///  Values below linear get one bin each. Above, every octave [2^k, 2^(k+1)) is split into per_octave bins of
+///  equal width, so a histogram of values up to 10^9 has a few hundred bins at most. The bins grow on demand.
+class accumulator_histogram
+{
+    public:
+        ///  @param linear must be a power of two and at least per_octave
+        ///  @param per_octave is the amount of bins per octave above linear (a power of two)
+        accumulator_histogram(unsigned const & linear = 32, unsigned const & per_octave = 4): linear_(linear)
+                                                                                            , per_octave_(per_octave)
+                                                                                            , count_(0) {
+        };
+        void operator<<(uint64_t const & x) {
+            unsigned const b = bin(x);
+            if(b >= hist_.size())
+                hist_.resize(b + 1, 0);
+            ++hist_[b];
+            ++count_;
+        }
+        ///  \brief adds the counts of other (same linear and per_octave)
+        void merge(accumulator_histogram const & other) {
+            if(hist_.size() < other.hist_.size())
+                hist_.resize(other.hist_.size(), 0);
+            for(unsigned b = 0; b < other.hist_.size(); ++b)
+                hist_[b] += other.hist_[b];
+            count_ += other.count_;
+        }
+        ///  \brief the bin of x
+        unsigned bin(uint64_t const & x) const {
+            if(x < linear_)
+                return x;
+            unsigned k = 0; //x is in the octave [2^k, 2^(k+1))
+            while((x >> k) > 1)
+                ++k;
+            unsigned const first = linear_ + (k - log2(linear_)) * per_octave_; //first bin of the octave
+            return first + ((x - (uint64_t(1) << k)) * per_octave_ >> k);
+        }
+        ///  \brief smallest value in bin b
+        uint64_t lower(unsigned const & b) const {
+            if(b < linear_)
+                return b;
+            unsigned const k = (b - linear_) / per_octave_ + log2(linear_);
+            unsigned const sub = (b - linear_) % per_octave_;
+            return (uint64_t(1) << k) + ((uint64_t(sub) << k) + per_octave_ - 1) / per_octave_;
+        }
+        ///  \brief largest value in bin b
+        uint64_t upper(unsigned const & b) const {
+            return lower(b + 1) - 1;
+        }
+        ///  \brief amount of bins (the last one is not empty)
+        unsigned size() const {
+            return hist_.size();
+        }
+        uint64_t const & operator[](unsigned const & b) const {
+            return hist_[b];
+        }
+        uint64_t const & count() const {
+            return count_;
+        }
+        ///  \brief fraction of the values in bin b
+        double prob(unsigned const & b) const {
+            return double(hist_[b]) / count_;
+        }
+        void print(std::ostream & os) const {
+            for(unsigned b = 0; b < hist_.size(); ++b)
+                if(hist_[b] != 0)
+                    os << "[" << lower(b) << ", " << upper(b) << "]: " << hist_[b] << " ";
+        }
+        template<typename Archive>
+        void serialize(Archive & ar) {
+            ar & linear_;
+            ar & per_octave_;
+            ar & count_;
+            ar & hist_;
+        }
+    private:
+        static unsigned log2(unsigned x) {
+            unsigned k = 0;
+            while(x > 1) {
+                x >>= 1;
+                ++k;
+            }
+            return k;
+        }
+    private:
+        unsigned linear_;
+        unsigned per_octave_;
+        uint64_t count_;
+        std::vector<uint64_t> hist_;
+};
+
+std::ostream & operator<<(std::ostream & os, accumulator_histogram const & acc) {
+    acc.print(os);
+    return os;
+}
+#endif //__ACCUM_HISTOGRAM_HEADER
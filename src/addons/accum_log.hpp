@@ -0,0 +1,115 @@
+// Author:  Mario S. Könz <mskoenz@gmx.net>
+// Date:    19.10.2026 13:57:30 EDT
+// File:    accum_log.hpp
+
+#ifndef __ACCUM_LOG_HEADER
+#define __ACCUM_LOG_HEADER
+
+#include <iostream>
+#include <limits>
+#include <cmath>
+
+///  \brief accumulator for samples 2^x that are only known by their exponent x
+///
+///  The sums of 2^x and 2^2x are kept relative to a shared offset (the largest x so far), i.e. a running
+///  log-sum-exp. Nothing over- or underflows as long as the samples differ by less than ~1000 from the
+///  largest one. All results are given as log2 values.
+class accumulator_log
+{
+    public:
+        accumulator_log(): count_(0), offset_(-std::numeric_limits<double>::infinity()), sum_(0), sum2_(0) {
+        };
+        ///  \brief adds the sample 2^x
+        void operator<<(double const & x) {
+            if(x > offset_)
+                rescale(x);
+            double w = std::exp2(x - offset_);
+            sum_ += w;
+            sum2_ += w * w;
+            ++count_;
+        }
+        ///  \brief adds the samples of other (e.g. of a replica)
+        void merge(accumulator_log const & other) {
+            if(other.count_ == 0)
+                return;
+            if(other.offset_ > offset_)
+                rescale(other.offset_);
+            double r = std::exp2(other.offset_ - offset_);
+            sum_ += other.sum_ * r;
+            sum2_ += other.sum2_ * r * r;
+            count_ += other.count_;
+        }
+        uint64_t count() const {
+            return count_;
+        }
+        ///  \brief log2 of the sum of all samples
+        double log_sum() const {
+            return offset_ + std::log2(sum_);
+        }
+        ///  \brief log2 of the mean
+        double log_mean() const {
+            return offset_ + std::log2(sum_ / count_);
+        }
+        ///  \brief the mean itself, may be inf or 0 if it does not fit in a double
+        double mean() const {
+            return std::exp2(log_mean());
+        }
+        ///  \brief error of log_mean (uncorrelated samples, first order)
+        double log_error() const {
+            double m = sum_ / count_;
+            double var = sum2_ / count_ - m * m;
+            return std::sqrt((var > 0 ? var : 0) / (count_ - 1)) / m / std::log(2.0);
+        }
+        void print(std::ostream & os) const {
+            os << "2^(";
+            os << log_mean();
+            os << "+/-";
+            os << log_error();
+            os << ")";
+        }
+        template<typename Archive>
+        void serialize(Archive & ar) {
+            ar & count_;
+            ar & offset_;
+            ar & sum_;
+            ar & sum2_;
+        }
+        ///  \brief log2(2^a + 2^b)
+        static double log2_add(double const & a, double const & b) {
+            if(a < b)
+                return log2_add(b, a);
+            if(b == -std::numeric_limits<double>::infinity())
+                return a;
+            return a + std::log2(1 + std::exp2(b - a));
+        }
+        ///  \brief log2(2^a - 2^b) for b <= a
+        ///
+        ///  -inf if b >= a, which rounding gives if 2^b is almost all of 2^a. Close to that the difference has
+        ///  no significant digits, jackknife_class therefore adds up the remaining blocks instead
+        static double log2_sub(double const & a, double const & b) {
+            if(b == -std::numeric_limits<double>::infinity())
+                return a;
+            if(b >= a)
+                return -std::numeric_limits<double>::infinity();
+            return a + std::log2(1 - std::exp2(b - a));
+        }
+    private:
+        ///  \brief moves the offset to x
+        void rescale(double const & x) {
+            double r = std::exp2(offset_ - x);
+            sum_ *= r;
+            sum2_ *= r * r;
+            offset_ = x;
+        }
+    private:
+        uint64_t count_;
+        double offset_; ///< largest exponent so far, the sums are relative to 2^offset_
+        double sum_;    ///< sum of 2^(x - offset_)
+        double sum2_;   ///< sum of 2^(2x - 2offset_)
+};
+
+std::ostream & operator<<(std::ostream & os, accumulator_log const & acc) {
+    acc.print(os);
+    return os;
+}
+#endif //__ACCUM_LOG_HEADER
@@ -0,0 +1,100 @@
+// Author:  Mario S. Könz <mskoenz@gmx.net>
+// Date:    19.10.2026 12:04:18 EDT
+// File:    accum_registry.hpp
+
+#ifndef __ACCUM_REGISTRY_HEADER
+#define __ACCUM_REGISTRY_HEADER
+
+/* minimal code
+
+#include <accum_registry.hpp>
+accum_registry<accumulator_double> data;
+auto const energy = data.add("energy"); //declare once
+data[energy] << 1.5; //no string is built, just an index
+data["other"] << 2; //works as well, but does a lookup every time
+
+*/
+
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "serialize/archive_enum.hpp"
+
+///  \brief flat array of accumulators that are declared once by name
+///
+///  add returns an integer handle, operator[](handle) is a plain index into the array. The names stay
+///  available for printing (for_each visits in alphabetical order) and serialization. The archive holds the
+///  count followed by (name, accumulator) pairs in alphabetical order, which makes it independent of the order
+///  in which the observables were added.
+template<typename A>
+class accum_registry {
+public:
+    typedef unsigned handle_type;
+
+    ///  \brief declares an observable and returns its handle
+    ///
+    ///  if the name is already declared, the existing handle is returned
+    handle_type add(std::string const & name) {
+        auto it = index_.find(name);
+        if(it != index_.end())
+            return it->second;
+        handle_type h = acc_.size();
+        index_[name] = h;
+        names_.push_back(name);
+        acc_.push_back(A());
+        return h;
+    }
+    ///  \brief fast access by handle
+    A & operator[](handle_type const & h) {
+        return acc_[h];
+    }
+    A const & operator[](handle_type const & h) const {
+        return acc_[h];
+    }
+    ///  \brief slow access by name, declares the observable if needed
+    A & operator[](std::string const & name) {
+        return acc_[add(name)];
+    }
+    A & operator[](char const * name) {
+        return acc_[add(name)];
+    }
+    std::string const & name(handle_type const & h) const {
+        return names_[h];
+    }
+    handle_type size() const {
+        return acc_.size();
+    }
+    ///  \brief calls fct(name, accumulator) for all observables in alphabetical order
+    template<typename F>
+    void for_each(F fct) {
+        for(auto it = index_.begin(); it != index_.end(); ++it)
+            fct(it->first, acc_[it->second]);
+    }
+    template<typename Archive>
+    void serialize(Archive & ar) {
+        unsigned size = acc_.size();
+        ar & size;
+        if(Archive::type == archive_enum::output) {
+            for(auto it = index_.begin(); it != index_.end(); ++it) {
+                std::string key = it->first;
+                ar & key;
+                ar & acc_[it->second];
+            }
+        } else if(Archive::type == archive_enum::input) {
+            std::string key;
+            A val;
+            for(unsigned i = 0; i < size; ++i) {
+                ar & key;
+                ar & val;
+                acc_[add(key)] = val;
+            }
+        }
+    }
+private:
+    std::vector<A> acc_;                        ///< the accumulators, indexed by handle
+    std::vector<std::string> names_;            ///< the names, indexed by handle
+    std::map<std::string, handle_type> index_;  ///< name -> handle, only used by add
+};
+#endif //__ACCUM_REGISTRY_HEADER
@@ -0,0 +1,166 @@
+// Author:  Mario S. Könz <mskoenz@gmx.net>
+// Date:    19.10.2026 20:02:47 EDT
+// File:    fft_msk.hpp
+
+#ifndef __FFT_MSK_HEADER
+#define __FFT_MSK_HEADER
+
+/* minimal code
+
+#include <fft_msk.hpp>
+addon::fft_2d_class fft(H, L);
+std::vector<std::complex<double>> data(H * L); //row-major, data[i * L + j]
+fft(data); //in place, data[qi * L + qj] = sum_ij exp(-2 pi i (qi i / H + qj j / L)) data[i * L + j]
+fft(data, true); //the inverse without the 1/(H L)
+fft.real_pair(a, b, fa, fb); //transforms of the two real fields a and b with one complex transform
+addon::fft_2d_class::workspace_struct ws; //optional, keeps the scratch memory between calls
+fft.real_pair(a, b, fa, fb, ws);
+
+*/
+
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <cstdint>
+
+//timer2_msk.hpp documents addon
+namespace addon {
+    ///  \brief plan of a one dimensional discrete fourier transform of length n
+    ///
+    ///  Powers of two use the iterative radix-2 algorithm in O(n log n), all other lengths fall back to the
+    ///  direct sum in O(n^2) with a precomputed table of the n roots of unity. Neither direction is normalized.
+    ///  The plan is only read by operator(), so one plan can be used by several threads at once
+    class fft_class {
+        typedef std::complex<double> complex_type;
+    public:
+        fft_class(unsigned const & n): n_(n), pow2_(n != 0 and (n & (n - 1)) == 0), root_(n), rev_(pow2_ ? n : 0) {
+            for(unsigned k = 0; k < n_; ++k)
+                root_[k] = std::polar(1.0, -2 * M_PI * k / n_);
+            if(pow2_) {
+                unsigned bits = 0;
+                while((1u << bits) < n_)
+                    ++bits;
+                for(unsigned k = 0; k < n_; ++k) {
+                    unsigned r = 0;
+                    for(unsigned b = 0; b < bits; ++b)
+                        r |= ((k >> b) & 1) << (bits - 1 - b);
+                    rev_[k] = r;
+                }
+            }
+        }
+        unsigned size() const {
+            return n_;
+        }
+        ///  \brief transforms data[0], data[stride], ..., data[(n - 1) * stride] in place
+        ///
+        ///  @param buffer is scratch space of at least n elements, s.t. nothing is allocated per call
+        void operator()(complex_type * data, unsigned const & stride, bool const & inverse, std::vector<complex_type> & buffer) const {
+            if(buffer.size() < n_)
+                buffer.resize(n_);
+            if(pow2_) {
+                for(unsigned k = 0; k < n_; ++k)
+                    buffer[rev_[k]] = data[k * stride];
+                double const sign = inverse ? -1 : 1;
+                double * const x = reinterpret_cast<double *>(buffer.data()); //re, im interleaved (guaranteed for std::complex)
+                double const * const root = reinterpret_cast<double const *>(root_.data());
+                for(unsigned half = 1; half < n_; half <<= 1) {
+                    unsigned const step = n_ / (2 * half);
+                    for(unsigned start = 0; start < n_; start += 2 * half)
+                        for(unsigned k = 0; k < half; ++k) {
+                            //written out, std::complex multiplication checks for inf and nan
+                            double const wr = root[2 * k * step];
+                            double const wi = sign * root[2 * k * step + 1];
+                            double * const u = x + 2 * (start + k);
+                            double * const v = x + 2 * (start + k + half);
+                            double const vr = v[0] * wr - v[1] * wi;
+                            double const vi = v[0] * wi + v[1] * wr;
+                            v[0] = u[0] - vr;
+                            v[1] = u[1] - vi;
+                            u[0] += vr;
+                            u[1] += vi;
+                        }
+                }
+            }
+            else {
+                for(unsigned k = 0; k < n_; ++k) {
+                    complex_type sum = 0;
+                    for(unsigned m = 0; m < n_; ++m) {
+                        complex_type const & w = root_[uint64_t(k) * m % n_];
+                        sum += data[m * stride] * (inverse ? std::conj(w) : w);
+                    }
+                    buffer[k] = sum;
+                }
+            }
+            for(unsigned k = 0; k < n_; ++k)
+                data[k * stride] = buffer[k];
+        }
+    private:
+        unsigned n_;
+        bool pow2_;                         ///< if the radix-2 algorithm is used
+        std::vector<complex_type> root_;    ///< exp(-2 pi i k / n)
+        std::vector<unsigned> rev_;         ///< bit reversed indices (only for powers of two)
+    };
+    ///  \brief two dimensional discrete fourier transform of a row-major H x L array, see fft_class
+    class fft_2d_class {
+        typedef std::complex<double> complex_type;
+    public:
+        ///  \brief scratch memory of the transforms, reused if it is passed to every call
+        struct workspace_struct {
+            std::vector<complex_type> z;        ///< a + i b in real_pair
+            std::vector<complex_type> buffer;   ///< see fft_class::operator()
+        };
+        fft_2d_class(unsigned const & H, unsigned const & L): H_(H), L_(L), col_(H), row_(L) {
+        }
+        ///  \brief transforms data in place, unnormalized in both directions
+        void operator()(std::vector<complex_type> & data, bool const & inverse = false) const {
+            std::vector<complex_type> buffer;
+            transform(data, inverse, buffer);
+        }
+        ///  \brief transforms the two real fields a and b with one complex transform of a + i b
+        ///
+        ///  the transform of a real field is hermitian, fa(-q) = conj(fa(q)), which separates the two results
+        void real_pair(std::vector<double> const & a
+                     , std::vector<double> const & b
+                     , std::vector<complex_type> & fa
+                     , std::vector<complex_type> & fb) const {
+            workspace_struct ws;
+            real_pair(a, b, fa, fb, ws);
+        }
+        ///  \brief real_pair with the scratch memory of ws, nothing is allocated once ws, fa and fb have their size
+        void real_pair(std::vector<double> const & a
+                     , std::vector<double> const & b
+                     , std::vector<complex_type> & fa
+                     , std::vector<complex_type> & fb
+                     , workspace_struct & ws) const {
+            std::vector<complex_type> & z = ws.z;
+            z.resize(H_ * L_);
+            for(unsigned k = 0; k < z.size(); ++k)
+                z[k] = complex_type(a[k], b[k]);
+            transform(z, false, ws.buffer);
+
+            fa.resize(z.size());
+            fb.resize(z.size());
+            for(unsigned i = 0; i < H_; ++i)
+                for(unsigned j = 0; j < L_; ++j) {
+                    complex_type const & zq = z[i * L_ + j];
+                    complex_type const zm = std::conj(z[(H_ - i) % H_ * L_ + (L_ - j) % L_]);
+                    fa[i * L_ + j] = (zq + zm) * .5;
+                    complex_type const diff = zq - zm;
+                    fb[i * L_ + j] = complex_type(.5 * diff.imag(), -.5 * diff.real()); //(zq - zm) / 2i
+                }
+        }
+    private:
+        void transform(std::vector<complex_type> & data, bool const & inverse, std::vector<complex_type> & buffer) const {
+            for(unsigned i = 0; i < H_; ++i)
+                row_(&data[i * L_], 1, inverse, buffer);
+            for(unsigned j = 0; j < L_; ++j)
+                col_(&data[j], L_, inverse, buffer);
+        }
+    private:
+        unsigned H_;
+        unsigned L_;
+        fft_class col_; ///< length H
+        fft_class row_; ///< length L
+    };
+}//end namespace addon
+#endif //__FFT_MSK_HEADER
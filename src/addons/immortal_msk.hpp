@@ -6,118 +6,323 @@
 #define __IMMORTAL_MSK_HEADER
 
 #include "serialize/fserial.hpp"
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <streambuf>
 #include <stdexcept>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 namespace addon {
+    namespace detail {
+        char const immortal_magic[8] = {'I', 'M', 'M', 'O', 'R', 'T', 'A', 'L'};
+        ///  \brief start of a checkpoint file, followed by the section table and the sections
+        struct immortal_header_struct {
+            char magic[8];
+            uint32_t version;
+            uint32_t n_sections;
+            uint64_t index;             ///< the index given to write_next_index
+            uint64_t table_checksum;    ///< of the section table
+        };
+        ///  \brief one entry of the section table, the sections start at multiples of 8 bytes
+        struct immortal_section_struct {
+            uint64_t offset;    ///< bytes from the start of the file
+            uint64_t size;      ///< bytes
+            uint64_t checksum;  ///< see immortal_checksum
+        };
+        ///  \brief 64 bit FNV-1a over 8 byte words (and the remaining bytes)
+        inline uint64_t immortal_checksum(char const * data, uint64_t const & size) {
+            uint64_t const prime = 0x100000001b3ull;
+            uint64_t h = 0xcbf29ce484222325ull;
+            uint64_t k = 0;
+            for(; k + 8 <= size; k += 8) {
+                uint64_t w;
+                std::memcpy(&w, data + k, 8);
+                h = (h ^ w) * prime;
+            }
+            for(; k < size; ++k)
+                h = (h ^ uint8_t(data[k])) * prime;
+            return h;
+        }
+        ///  \brief streambuf that reads from memory, s.t. iss_class can read a mapped section
+        struct memory_source: public std::streambuf {
+            memory_source(char const * data, uint64_t const & size) {
+                char * p = const_cast<char *>(data); //only the get area is used, nothing is written
+                setg(p, p, p + size);
+            }
+        };
+    }//end namespace detail
+    ///  \brief keeps the newest checkpoint in one state file that is replaced atomically
+    ///
+    ///  operator<< serializes to memory, write_next_index publishes it together with the index: the
+    ///  file is written to a temporary, synced and renamed over the state file. A crash leaves either the
+    ///  old or the new checkpoint, never a mix. write_async does the publishing on a background thread.
+    ///
+    ///  The file is an immortal_header_struct, the section table and the sections: the signature (see
+    ///  set_signature), the serialized object and one raw section per array that the object stores with
+    ///  serialize_view (e.g. the bonds and spins of grid_class). Restoring maps the file, parses the object
+    ///  from the mapped data section and hands the raw sections to it as pointers into the map, they are
+    ///  applied without parsing. available throws if the file has an unknown version, a checksum doesn't
+    ///  match or the signature differs, instead of misreading the checkpoint.
     class immortal_class {
-        typedef unsigned index_type;
+        typedef uint64_t index_type;
+        ///  \brief stream interface for oss_class that appends to a vector, the raw sections are kept apart
+        struct memory_sink: public raw_section_stream {
+            memory_sink(): n_raw(0) {
+            }
+            void write(char const * p, std::streamsize const & n) {
+                buffer.insert(buffer.end(), p, p + n);
+            }
+            void raw_write(void const * p, uint64_t const & size) {
+                if(n_raw == raw.size())
+                    raw.push_back(std::vector<char>());
+                raw[n_raw].assign((char const *)p, (char const *)p + size); //keeps the memory for the next checkpoint
+                ++n_raw;
+            }
+            void clear() {
+                buffer.clear();
+                n_raw = 0;
+            }
+            std::vector<char> buffer;
+            std::vector<std::vector<char>> raw; ///< only the first n_raw are in use
+            unsigned n_raw;
+        };
+        ///  \brief read-only map of a whole file, data is nullptr if the file is missing or empty
+        struct map_struct {
+            map_struct(std::string const & name): data(nullptr), size(0) {
+                int fd = open(name.c_str(), O_RDONLY);
+                if(fd == -1)
+                    return;
+                struct stat st;
+                if(fstat(fd, &st) == 0 and st.st_size > 0) {
+                    void * p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if(p != MAP_FAILED) {
+                        data = static_cast<char const *>(p);
+                        size = st.st_size;
+                    }
+                }
+                close(fd);
+            }
+            ~map_struct() {
+                if(data != nullptr)
+                    munmap(const_cast<char *>(data), size);
+            }
+            map_struct(map_struct const &) = delete;
+            map_struct & operator=(map_struct const &) = delete;
+            char const * data;
+            uint64_t size;
+        };
+        enum section_enum {signature_section = 0, data_section, first_raw_section};
+        ///  \brief stream interface for iss_class on a checked map, raw_read returns the raw sections in order
+        struct map_source: public std::istream, public raw_section_stream {
+            map_source(map_struct const & map, uint32_t const & n_sections):
+                      std::istream(nullptr)
+                    , map(map)
+                    , buffer(map.data + table(map)[data_section].offset, table(map)[data_section].size)
+                    , next(first_raw_section)
+                    , n_sections(n_sections) {
+                rdbuf(&buffer);
+            }
+            char const * raw_read(uint64_t const & size) {
+                if(next == n_sections)
+                    throw std::runtime_error("immortal_class: the checkpoint has fewer raw sections than expected");
+                detail::immortal_section_struct const & sec = table(map)[next++];
+                if(sec.size != size)
+                    throw std::runtime_error("immortal_class: a raw section of the checkpoint has the wrong size");
+                return map.data + sec.offset; //the sections start at multiples of 8 bytes of the page aligned map
+            }
+            map_struct const & map;
+            detail::memory_source buffer;
+            uint32_t next;
+            uint32_t const n_sections;
+        };
     public:
+        static uint32_t const version = 2; ///< of the file layout
         //------------------- ctors -------------------
-        immortal_class(): file_switch_(2) //"invalid" at start
-                        , index_(0) {
-                            
-            data_file_[0] = "immortal1.bin";
-            data_file_[1] = "immortal2.bin";
-            index_file_[0] = "immortal3.bin";
-            index_file_[1] = "immortal4.bin";
-            d_arch_[0].set_name(data_file_[0]);
-            d_arch_[1].set_name(data_file_[1]);
+        immortal_class(): file_("immortal.bin")
+                        , index_(0)
+                        , loaded_(false)
+                        , sink_arch_(sink_) {
+        }
+        ~immortal_class() {
+            wait();
         }
         //------------------- info -------------------
+        ///  \brief true if there is a checkpoint, get_index then returns its index
+        ///
+        ///  throws a runtime_error if the checkpoint is damaged or from an incompatible build
         bool available() {
-            bool d1ex = exists(data_file_[0]);
-            bool d2ex = exists(data_file_[1]);
-            bool i1ex = exists(index_file_[0]);
-            bool i2ex = exists(index_file_[1]);
-            
-            assert((i1ex and d1ex) or (!i1ex and !d1ex));
-            assert((i2ex and d2ex) or (!i2ex and !d2ex));
-            
-            index_type i1 = i1ex ? try_to_read_index(0) : 0;
-            index_type i2 = i2ex ? try_to_read_index(1) : 0;
-            
-            if(i1ex)
-                if((i1 != 0 and i2 == 0) or (i1 >= i2)) {
-                    file_switch_ = 0;
-                    index_ = i1;
-                    return true;
-                }
-            if(i2ex)
-                if((i1 == 0 and i2 != 0) or (i2 >= i1)) {
-                    file_switch_ = 1;
-                    index_ = i2;
-                    return true;
-                }
-            file_switch_ = 0;
-            return false;
-        }
-        index_type try_to_read_index(uint8_t const & pos) {
-            index_type res = 0;
-            char end = 0;
-            std::ifstream ifs(index_file_[pos], std::ios::in);
-            ifs >> res;
-            ifs >> end;
-            if(end == 'e')
-                return res;
-            else
-                return 0;
+            wait();
+            map_struct map(file_);
+            loaded_ = false;
+            if(map.data == nullptr)
+                return false;
+            index_ = check(map).index;
+            loaded_ = true;
+            return true;
         }
         //------------------- ops -------------------
         void set_path(std::string const & path) {
-            data_file_[0] = path + "/" + data_file_[0];
-            data_file_[1] = path + "/" + data_file_[1];
-            index_file_[0] = path + "/" + index_file_[0];
-            index_file_[1] = path + "/" + index_file_[1];
-            d_arch_[0].set_name(data_file_[0]);
-            d_arch_[1].set_name(data_file_[1]);
+            wait();
+            file_ = path + "/" + file_;
         }
+        ///  \brief describes what is checkpointed (e.g. lattice and size), a checkpoint with another one is rejected
+        void set_signature(std::string const & signature) {
+            wait();
+            signature_ = signature;
+        }
+        ///  \brief serializes t to memory, write_next_index publishes it
         template<typename T>
         void operator<<(T & t) {
-            assert(file_switch_ < 2);
-            d_arch_[file_switch_] << t;
+            wait();
+            sink_.clear(); //keeps the memory for the next checkpoint
+            sink_arch_ & t;
         }
+        ///  \brief restores t from the mapped checkpoint (checked like in available)
         template<typename T>
         void operator>>(T & t) {
-            assert(file_switch_ < 2);
-            d_arch_[file_switch_] >> t;
-            file_switch_ = 1 - file_switch_;
+            map_struct map(file_);
+            if(map.data == nullptr)
+                throw std::runtime_error("immortal_class: no checkpoint in " + file_);
+            detail::immortal_header_struct const h = check(map);
+            index_ = h.index;
+            map_source source(map, h.n_sections);
+            iss_class<map_source> ar(source);
+            ar & t;
+            if(source.next != h.n_sections)
+                throw std::runtime_error("immortal_class: the checkpoint has more raw sections than expected");
         }
         index_type get_index(index_type const & defa = 0) {
-            if(file_switch_ < 2) {
-                return index_;
-            }
-            else {
-                file_switch_ = 0;
-                return defa;
-            }
+            return loaded_ ? index_ : defa;
         }
+        ///  \brief publishes the checkpoint of the last operator<< with index i
         void write_next_index(index_type const & i) {
             index_ = i;
-            std::ofstream ofs(index_file_[file_switch_]);
-            ofs << index_;
-            ofs << ' ';
-            ofs << 'e';
-            file_switch_ = 1 - file_switch_;
+            publish(i);
+        }
+        ///  \brief operator<< followed by write_next_index on a background thread
+        ///
+        ///  only the serialization to memory happens here (t can change right after). A previous
+        ///  write_async is waited for first, so at most one write is in flight.
+        template<typename T>
+        void write_async(T & t, index_type const & i) {
+            (*this) << t;
+            index_ = i;
+            writer_ = std::thread([this, i]() {publish(i);});
+        }
+        ///  \brief waits until the checkpoint of write_async is published
+        void wait() {
+            if(writer_.joinable())
+                writer_.join();
         }
         void reset() {
-            remove(data_file_[0].c_str());
-            remove(data_file_[1].c_str());
-            remove(index_file_[0].c_str());
-            remove(index_file_[1].c_str());
-            file_switch_ = 0;
+            wait();
+            remove(file_.c_str());
+            remove(temp_file().c_str());
+            loaded_ = false;
         }
     private:
-        bool exists(std::string const & filename) {
-            std::ifstream ifs(filename.c_str());
-            return ifs.is_open();
+        std::string temp_file() const {
+            return file_ + ".tmp";
+        }
+        static detail::immortal_section_struct const * table(map_struct const & map) {
+            return reinterpret_cast<detail::immortal_section_struct const *>(map.data + sizeof(detail::immortal_header_struct));
+        }
+        ///  \brief validates the mapped checkpoint and returns its header, throws if anything is wrong
+        detail::immortal_header_struct check(map_struct const & map) const {
+            std::string const what = "immortal_class: the checkpoint " + file_;
+            detail::immortal_header_struct h;
+            if(map.size < sizeof(h) or std::memcmp(map.data, detail::immortal_magic, 8) != 0)
+                throw std::runtime_error(what + " has no header (older run? use -del)");
+            std::memcpy(&h, map.data, sizeof(h));
+            if(h.version != version)
+                throw std::runtime_error(what + " has version " + std::to_string(h.version) + ", this build reads " + std::to_string(version));
+            uint64_t const table_end = sizeof(h) + uint64_t(h.n_sections) * sizeof(detail::immortal_section_struct);
+            if(h.n_sections < first_raw_section or map.size < table_end
+               or detail::immortal_checksum(map.data + sizeof(h), table_end - sizeof(h)) != h.table_checksum)
+                throw std::runtime_error(what + " has a damaged section table");
+            for(unsigned k = 0; k < h.n_sections; ++k) {
+                detail::immortal_section_struct const & sec = table(map)[k];
+                if(sec.offset < table_end or sec.offset % 8 != 0 or sec.offset > map.size or sec.size > map.size - sec.offset
+                   or detail::immortal_checksum(map.data + sec.offset, sec.size) != sec.checksum)
+                    throw std::runtime_error(what + " is damaged (section " + std::to_string(k) + ")");
+            }
+            detail::immortal_section_struct const & sig = table(map)[signature_section];
+            std::string const signature(map.data + sig.offset, sig.size);
+            if(signature != signature_)
+                throw std::runtime_error(what + " was written for \"" + signature + "\", this run is \"" + signature_ + "\"");
+            return h;
+        }
+        ///  \brief writes the header, signature_ and sink_ to the temporary, syncs it and renames it to file_
+        ///
+        ///  if anything fails the old state file stays and a warning is printed
+        void publish(index_type const & i) {
+            std::vector<char const *> data = {signature_.data(), sink_.buffer.data()};
+            std::vector<uint64_t> size = {signature_.size(), sink_.buffer.size()};
+            for(unsigned k = 0; k < sink_.n_raw; ++k) {
+                data.push_back(sink_.raw[k].data());
+                size.push_back(sink_.raw[k].size());
+            }
+            uint32_t const n_sections = data.size();
+            
+            detail::immortal_header_struct h;
+            std::vector<detail::immortal_section_struct> sec(n_sections);
+            uint64_t const table_size = n_sections * sizeof(detail::immortal_section_struct);
+            uint64_t offset = sizeof(h) + table_size; //a multiple of 8
+            for(unsigned k = 0; k < n_sections; ++k) {
+                sec[k].offset = offset;
+                sec[k].size = size[k];
+                sec[k].checksum = detail::immortal_checksum(data[k], size[k]);
+                offset = (offset + size[k] + 7) / 8 * 8;
+            }
+            std::memcpy(h.magic, detail::immortal_magic, 8);
+            h.version = version;
+            h.n_sections = n_sections;
+            h.index = i;
+            h.table_checksum = detail::immortal_checksum(reinterpret_cast<char const *>(sec.data()), table_size);
+            
+            std::string const temp = temp_file();
+            FILE * f = std::fopen(temp.c_str(), "wb");
+            bool ok = f != nullptr;
+            if(ok) {
+                char const pad[8] = {0};
+                ok = std::fwrite(&h, sizeof(h), 1, f) == 1 and std::fwrite(sec.data(), table_size, 1, f) == 1;
+                for(unsigned k = 0; k < n_sections; ++k)
+                    ok = ok and std::fwrite(data[k], 1, size[k], f) == size[k]
+                            and std::fwrite(pad, 1, (8 - size[k] % 8) % 8, f) == (8 - size[k] % 8) % 8;
+                ok = ok and std::fflush(f) == 0 and fsync(fileno(f)) == 0;
+                ok = (std::fclose(f) == 0) and ok;
+            }
+            if(ok)
+                ok = std::rename(temp.c_str(), file_.c_str()) == 0;
+            if(not ok) {
+                std::cerr << "immortal_class: couldn't write the checkpoint " << file_ << std::endl;
+                remove(temp.c_str());
+                return;
+            }
+            //the rename itself is only durable once the directory is synced
+            std::string::size_type const slash = file_.rfind('/');
+            int dir = open(slash == std::string::npos ? "." : file_.substr(0, slash + 1).c_str(), O_RDONLY);
+            if(dir != -1) {
+                fsync(dir);
+                close(dir);
+            }
         }
     private:
-        uint8_t file_switch_;
-        std::string data_file_[2];
-        std::string index_file_[2];
-        fserial_class d_arch_[2];
-        
+        std::string file_;
+        std::string signature_;
         index_type index_;
+        bool loaded_;                       ///< if available found a checkpoint
+        memory_sink sink_;                  ///< the serialized checkpoint
+        oss_class<memory_sink> sink_arch_;
+        std::thread writer_;                ///< publishes sink_ for write_async
     } immortal;
 }//end namespace addon
 
@@ -13,7 +13,10 @@
 #include "byte_operation.hpp"
 #include "../color.hpp"
 
+#include <vector>
 #include <assert.h>
+#include <stdexcept>
+#include <type_traits>
 
 namespace addon {
     //------------------- checks of T is a class and has a template method called serialize -------------------
@@ -21,7 +24,10 @@ namespace addon {
     struct has_serialize_impl {
         struct archive_proto_type {
             static archive_enum const type = archive_enum::undef;
+            typedef archive_proto_type stream_type;
             template<typename U> void operator &(U & u);
+            void block(void const * p, uint64_t const & size);
+            archive_proto_type & stream();
         };
         template<void(T::*)(archive_proto_type &)> struct helper {typedef char type;};
         
@@ -41,13 +47,99 @@ namespace addon {
     //------------------- implementation -------------------
     template<typename T, typename Archive>
     void serialize(Archive & ar, T & t);
+    //------------------- bulk fast path -------------------
+    ///  \brief if T can be written as its raw bytes (no serialize and trivially copyable)
+    template<typename T> 
+    struct is_bulk {
+        enum { value = std::is_trivially_copyable<T>::value and not has_serialize<T>::value };
+    };
+    ///  \brief serializes the n elements at t as one block (T must be is_bulk)
+    ///  
+    ///  the block starts with a type tag (sizeof(T)) and n, so a reader with a different
+    ///  type or length throws instead of misreading everything after it
+    template<typename T, typename Archive>
+    void serialize_block(Archive & ar, T * t, uint64_t const & n) {
+        uint64_t tag = sizeof(T);
+        uint64_t size = n;
+        ar & tag;
+        ar & size;
+        if(tag != sizeof(T) or size != n) //only possible for input
+            throw std::runtime_error("serialize_block: the stored block doesn't match the type or length");
+        ar.block(t, n * sizeof(T));
+    }
+    template<typename T, bool is_bulk_tpl> //default == true
+    struct range_helper {
+        template<typename Archive>
+        static void get(Archive & ar, T * t, uint64_t const & n) {
+            serialize_block(ar, t, n);
+        }
+    };
+    template<typename T> //element by element
+    struct range_helper<T, false> {
+        template<typename Archive>
+        static void get(Archive & ar, T * t, uint64_t const & n) {
+            for(uint64_t i = 0; i < n; ++i)
+                ar & t[i];
+        }
+    };
+    ///  \brief serializes the n contiguous elements at t, as one block if T is_bulk (decided at compile time)
+    template<typename T, typename Archive>
+    void serialize_range(Archive & ar, T * t, uint64_t const & n) {
+        range_helper<T, is_bulk<T>::value>::get(ar, t, n);
+    }
+    //------------------- raw sections -------------------
+    ///  \brief base of the streams that keep large arrays in sections of their own (see immortal_class)
+    ///  
+    ///  an output stream has void raw_write(void const * p, uint64_t size), an input stream
+    ///  char const * raw_read(uint64_t size) that returns the next section (and throws if its size differs)
+    struct raw_section_stream {
+    };
+    template<typename T, archive_enum type, bool has_raw_sections> //default == false, like a vector of n elements
+    struct view_helper {
+        template<typename Archive>
+        static void get(Archive & ar, T const *& view, std::vector<T> & storage, uint64_t const & n) {
+            uint64_t size = n;
+            ar & size;
+            if(size != n) //only possible for input
+                throw std::runtime_error("serialize_view: the stored array doesn't have the expected length");
+            if(type == archive_enum::input) {
+                storage.resize(n);
+                view = storage.data();
+            }
+            serialize_range(ar, const_cast<T *>(view), n); //output doesn't write to it
+        }
+    };
+    template<typename T>
+    struct view_helper<T, archive_enum::output, true> {
+        template<typename Archive>
+        static void get(Archive & ar, T const *& view, std::vector<T> & storage, uint64_t const & n) {
+            ar.stream().raw_write(view, n * sizeof(T));
+        }
+    };
+    template<typename T>
+    struct view_helper<T, archive_enum::input, true> {
+        template<typename Archive>
+        static void get(Archive & ar, T const *& view, std::vector<T> & storage, uint64_t const & n) {
+            view = reinterpret_cast<T const *>(ar.stream().raw_read(n * sizeof(T)));
+        }
+    };
+    ///  \brief serializes n elements (T must be is_bulk), written from view and read to view
+    ///  
+    ///  if the stream has raw sections the elements get a section of their own and after reading view points
+    ///  into the memory of the stream (only valid while the stream is). Otherwise they are stored like a vector
+    ///  and read to storage
+    template<typename T, typename Archive>
+    void serialize_view(Archive & ar, T const *& view, std::vector<T> & storage, uint64_t const & n) {
+        static_assert(is_bulk<T>::value, "serialize_view needs a type that can be copied as bytes");
+        view_helper<T, Archive::type, std::is_base_of<raw_section_stream, typename Archive::stream_type>::value>::get(ar, view, storage, n);
+    }
     //------------------- recursively serializes arrays :D -------------------
     template<typename T, typename Archive, archive_enum type, bool is_an_array> //default == true
     struct impl_version {
         static void get(T & t, Archive & ar) {
-            for(uint16_t i = 0; i < sizeof(t)/sizeof(t[0]); ++i) {
-                serialize(ar, t[i]); //<-calls serialize for subarrays
-            }
+            typedef typename std::remove_all_extents<T>::type element_type;
+            //the whole (multidimensional) array at once
+            serialize_range(ar, reinterpret_cast<element_type *>(&t), sizeof(t) / sizeof(element_type));
         }
     };
     template<typename T, typename Archive>
@@ -65,8 +157,7 @@ namespace addon {
                         --idx;
                 }
                 ar.write(idx);
-                for(uint8_t i = 0; i < idx; ++i)
-                    ar.write(util::read_byte(t, i));
+                ar.block(&t, idx);
             #else //__LESS_ZERO
                 for(uint8_t i = 0; i < sizeof(t); ++i)
                     ar.write(util::read_byte(t, i));
@@ -82,8 +173,7 @@ namespace addon {
             #endif //__TYPE_SIZE_CHECK
             #ifdef __LESS_ZERO
                 uint8_t idx = ar.read();
-                for(uint8_t i = 0; i < idx; ++i)
-                    util::write_byte(t, i, ar.read());
+                ar.block(&t, idx);
                 for(uint8_t i = idx; i < sizeof(t); ++i) {
                     util::write_byte(t, i, 0x00);
                 }
@@ -113,24 +203,60 @@ namespace addon {
         serialize_helper<T, has_serialize<T>::value, Archive>().get(ar, t);
     }
     //------------------- of class -------------------
+    ///  \brief output archive, collects the bytes of a top level operator& and hands them to data at once
+    ///  
+    ///  the many small writes of a nested object only append to buffer_, the stream sees one write per
+    ///  top level object (or per 64 kB)
     template<typename D>
     class oss_class {
         typedef uint16_t size_type;
     public:
         static archive_enum const type = archive_enum::output;
+        typedef D stream_type;
         
-        oss_class(D & data): data(data) {
+        oss_class(D & data): data(data), depth_(0) {
         }
         template<typename T>
         oss_class & operator&(T & t) {
-            serialize(*this, t);
+            ++depth_;
+            try {
+                serialize(*this, t);
+            } catch(...) { //the next top level object starts clean
+                depth_ = 0;
+                buffer_.clear();
+                throw;
+            }
+            if(--depth_ == 0)
+                flush();
             return (*this);
         }
         void write(uint8_t const & in) {
-            data.write((char*)&in, 1);
+            buffer_.push_back(in);
+        }
+        D & stream() {
+            return data;
+        }
+        ///  \brief writes the size bytes at in
+        void block(void const * in, uint64_t const & size) {
+            char const * p = (char const *)in;
+            if(size >= (1u << 16)) { //large blocks go to data directly
+                flush();
+                data.write(p, size);
+                return;
+            }
+            buffer_.insert(buffer_.end(), p, p + size);
+            if(buffer_.size() >= (1u << 16))
+                flush();
+        }
+    private:
+        void flush() {
+            data.write(buffer_.data(), buffer_.size());
+            buffer_.clear();
         }
     private:
         D & data;
+        unsigned depth_; ///< nesting of operator&
+        std::vector<char> buffer_;
     };
     //------------------- if class -------------------
     template<typename D>
@@ -138,6 +264,7 @@ namespace addon {
         typedef uint16_t size_type;
     public:
         static archive_enum const type = archive_enum::input;
+        typedef D stream_type;
         
         iss_class(D & data): data(data) {
         }
@@ -148,9 +275,17 @@ namespace addon {
         }
         uint8_t read() {
             char res = 0;
-            data.read(&res, 1);
+            block(&res, 1);
             return res;
         }
+        D & stream() {
+            return data;
+        }
+        ///  \brief reads size bytes to out with one call, throws at the end of the data
+        void block(void * out, uint64_t const & size) {
+            if(uint64_t(data.rdbuf()->sgetn((char *)out, size)) != size)
+                throw std::runtime_error("iss_class: unexpected end of the data");
+        }
     private:
         D & data;
     };
@@ -9,41 +9,27 @@
 #include <algorithm>
 
 #include "../archive_enum.hpp"
-#include "../byte_operation.hpp"
 
 namespace addon {
-    template<unsigned N, typename Archive>
+    ///  \brief N/64 + 1 words of 64 bits, the lowest bits first
+    ///  
+    ///  the words are cut out with shifts and masks instead of bit by bit
+    template<std::size_t N, typename Archive>
     void serialize(Archive & ar, std::bitset<N> & arg) {
-        unsigned idx = 0;
+        std::bitset<N> const mask(~uint64_t(0));
         uint64_t in = 0;
         if(Archive::type == archive_enum::input) {
-            for(unsigned i = 0; i < N/64; ++i) {
+            arg.reset();
+            for(unsigned i = 0; i <= N/64; ++i) {
                 ar & in;
-                for(uint8_t j = 0; j < 64; ++j) {
-                    arg[idx] = util::read_bit(in, j);
-                    ++idx;
-                }
-            }
-            ar & in;
-            for(uint8_t j = 0; idx < N; ++j) {
-                arg[idx] = util::read_bit(in, j);
-                    ++idx;
+                arg |= std::bitset<N>(in) << (64 * i);
             }
         }
         else if(Archive::type == archive_enum::output) {
-            for(unsigned i = 0; i < N/64; ++i) {
-                for(uint8_t j = 0; j < 64; ++j) {
-                    util::write_bit(in, j, arg[idx]);
-                    ++idx;
-                }
+            for(unsigned i = 0; i <= N/64; ++i) {
+                in = ((arg >> (64 * i)) & mask).to_ullong();
                 ar & in;
             }
-            in = 0;
-            for(uint8_t j = 0; idx < N; ++j) {
-                util::write_bit(in, j, arg[idx]);
-                ++idx;
-            }
-            ar & in;
         }
     }
 }//end namespace addon
@@ -9,11 +9,12 @@
 #include <boost/multi_array.hpp>
 #include <algorithm>
 
+#include "../serializer.hpp"
+
 namespace addon {
-    template<typename T, unsigned N, typename Archive>
+    template<typename T, std::size_t N, typename Archive>
     void serialize(Archive & ar, boost::multi_array<T, N> & arg) {
-        for(T * i = arg.data(); i < arg.data() + arg.num_elements(); ++i)
-            ar & *i;
+        serialize_range(ar, arg.data(), arg.num_elements());
     }
 }//end namespace addon
 #endif //__BOOST_MULTIARRAY_SUPPORT_HEADER
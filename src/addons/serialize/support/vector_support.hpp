@@ -8,6 +8,8 @@
 #include <iostream>
 #include <vector>
 
+#include "../serializer.hpp"
+
 //------------------- print & serialize -------------------
 template<typename T, typename S>
 S & operator<<(S & os, std::vector<T> const & arg) {
@@ -30,8 +32,21 @@ namespace addon {
         if(Archive::type == archive_enum::input) {
             arg.resize(size_);
         }
+        serialize_range(ar, arg.data(), size_);
+    }
+    ///  \brief std::vector<bool> has no data(), the bits go one by one
+    template<typename Archive>
+    void serialize(Archive & ar, std::vector<bool> & arg) {
+        typedef std::vector<bool>::size_type size_type;
+        size_type size_ = arg.size();
+        ar & size_;
+        if(Archive::type == archive_enum::input) {
+            arg.resize(size_);
+        }
         for(size_type i = 0; i < size_; ++i) {
-            ar & arg[i];
+            bool bit = arg[i];
+            ar & bit;
+            arg[i] = bit;
         }
     }
 }//end namespace addon
@@ -0,0 +1,167 @@
+// Author:  Mario S. Könz <mskoenz@gmx.net>
+// Date:    19.10.2026 18:05:12 EDT
+// File:    snapshot_ring_msk.hpp
+
+#ifndef __SNAPSHOT_RING_MSK_HEADER
+#define __SNAPSHOT_RING_MSK_HEADER
+
+/* minimal code
+
+#include <snapshot_ring_msk.hpp>
+addon::snapshot_ring_class<std::vector<int>, double> ring(4, 2, //4 slots, 2 workers
+    [&](std::vector<int> const & snap, unsigned const & worker) {return expensive(snap);});
+ring.publish([&](std::vector<int> & snap) {snap = config;}); //false (and nothing happens) if all slots are busy
+ring.collect([&](double const & res) {acc << res;}); //records the finished results, never waits
+ring.drain([&](double const & res) {acc << res;}); //waits for all published snapshots
+
+*/
+
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+//timer2_msk.hpp documents addon
+namespace addon {
+    ///  \brief ring of snapshot slots that are processed by background workers
+    ///
+    ///  One producer thread fills free slots (publish), the workers turn them into results with the compute
+    ///  function and the producer takes the results back in the order of publishing (collect / drain). If all
+    ///  slots are in use, publish skips the snapshot instead of waiting, so the producer never blocks on the
+    ///  workers except in drain. Slots are reused, so snapshots with an expensive allocation are only built once.
+    ///  publish, collect and drain must be called by the same thread.
+    template<typename S, typename R>
+    class snapshot_ring_class {
+        ///  \brief free: owned by the producer, filled: waits for a worker, done: result ready
+        enum class slot_state {free, filled, done};
+        struct slot_struct {
+            slot_struct(): state(slot_state::free) {
+            }
+            S snapshot;
+            R result;
+            slot_state state;
+        };
+    public:
+        ///  \brief the only constructor
+        ///
+        ///  @param n_slots is the maximal amount of snapshots in flight
+        ///  @param n_workers is the amount of background threads
+        ///  @param compute is called as compute(snapshot, worker) and returns the result, worker is in [0, n_workers)
+        template<typename F>
+        snapshot_ring_class(unsigned const & n_slots, unsigned const & n_workers, F compute):  slot_(n_slots < 1 ? 1 : n_slots)
+                                                                                             , compute_(compute)
+                                                                                             , head_(0)
+                                                                                             , next_(0)
+                                                                                             , tail_(0)
+                                                                                             , skipped_(0)
+                                                                                             , stop_(false) {
+            for(unsigned w = 0; w < n_workers; ++w)
+                worker_.push_back(std::thread(&snapshot_ring_class::work, this, w));
+        }
+        ~snapshot_ring_class() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_all();
+            for(unsigned i = 0; i < worker_.size(); ++i)
+                worker_[i].join();
+        }
+        snapshot_ring_class(snapshot_ring_class const &) = delete;
+        snapshot_ring_class & operator=(snapshot_ring_class const &) = delete;
+
+        ///  \brief calls fill(snapshot) on a free slot and hands it to the workers
+        ///
+        ///  returns false without calling fill if all slots are in use (back-pressure)
+        template<typename F>
+        bool publish(F fill) {
+            slot_struct * slot;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if(head_ - tail_ == slot_.size()) {
+                    ++skipped_;
+                    return false;
+                }
+                slot = &slot_[head_ % slot_.size()];
+            }
+            fill(slot->snapshot); //free slots belong to the producer, no lock needed
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                slot->state = slot_state::filled;
+                ++head_;
+            }
+            wake_.notify_one();
+            return true;
+        }
+        ///  \brief calls record(result) for the finished results in the order of publishing, doesn't wait
+        template<typename F>
+        void collect(F record) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while(tail_ != head_ and slot_[tail_ % slot_.size()].state == slot_state::done)
+                take(lock, record);
+        }
+        ///  \brief calls record(result) for all published snapshots, waits for the workers if needed
+        template<typename F>
+        void drain(F record) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while(tail_ != head_) {
+                done_.wait(lock, [&]() {return slot_[tail_ % slot_.size()].state == slot_state::done;});
+                take(lock, record);
+            }
+        }
+        ///  \brief amount of snapshots that were not published because all slots were in use
+        uint64_t skipped() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return skipped_;
+        }
+    private:
+        ///  \brief records the result in slot tail_ (must be done) and frees the slot
+        template<typename F>
+        void take(std::unique_lock<std::mutex> & lock, F & record) {
+            slot_struct & slot = slot_[tail_ % slot_.size()];
+            lock.unlock();
+            record(slot.result);
+            lock.lock();
+            slot.state = slot_state::free;
+            ++tail_;
+        }
+        ///  \brief main loop of worker w
+        void work(unsigned const w) {
+            while(true) {
+                slot_struct * slot;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    wake_.wait(lock, [&]() {return stop_ or next_ != head_;});
+                    if(stop_)
+                        return;
+                    slot = &slot_[next_ % slot_.size()];
+                    ++next_;
+                }
+                R res = compute_(slot->snapshot, w);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    slot->result = std::move(res);
+                    slot->state = slot_state::done;
+                }
+                done_.notify_one();
+            }
+        }
+    private:
+        std::vector<slot_struct> slot_;
+        std::function<R(S const &, unsigned)> compute_;
+        std::vector<std::thread> worker_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable wake_;  ///< signals a filled slot (or stop) to the workers
+        std::condition_variable done_;  ///< signals a done slot to the producer
+
+        uint64_t head_;     ///< snapshots published so far
+        uint64_t next_;     ///< snapshots taken by the workers so far
+        uint64_t tail_;     ///< results recorded so far
+        uint64_t skipped_;  ///< snapshots that found no free slot
+        bool stop_;
+    };
+}//end namespace addon
+#endif //__SNAPSHOT_RING_MSK_HEADER
@@ -0,0 +1,128 @@
+// Author:  Mario S. Könz <mskoenz@gmx.net>
+// Date:    19.10.2026 09:12:40 EDT
+// File:    thread_pool_msk.hpp
+
+#ifndef __THREAD_POOL_MSK_HEADER
+#define __THREAD_POOL_MSK_HEADER
+
+/* minimal code
+
+#include <thread_pool_msk.hpp>
+addon::thread_pool_class pool(4);
+pool.run(8, [&](unsigned const & job){ work(job); }); //blocks until all 8 jobs are done
+
+*/
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+//timer2_msk.hpp documents addon
+namespace addon {
+    ///  \brief small persistent pool that runs indexed jobs
+    ///
+    ///  The workers are started once and sleep between two calls of run. The calling thread
+    ///  also takes jobs, so a pool of size n uses n - 1 extra threads. A pool of size 0 or 1
+    ///  just runs all jobs inline, so there is no overhead if threading is not wanted.
+    class thread_pool_class {
+    public:
+        ///  \brief the only constructor
+        ///
+        ///  @param n_threads is the total amount of threads that work on a run (including the caller)
+        thread_pool_class(unsigned const & n_threads = 0): size_(n_threads < 1 ? 1 : n_threads)
+                                                         , generation_(0)
+                                                         , n_jobs_(0)
+                                                         , next_job_(0)
+                                                         , busy_(0)
+                                                         , stop_(false) {
+            for(unsigned i = 1; i < size_; ++i)
+                worker_.push_back(std::thread(&thread_pool_class::work, this));
+        }
+        ~thread_pool_class() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_all();
+            for(unsigned i = 0; i < worker_.size(); ++i)
+                worker_[i].join();
+        }
+        thread_pool_class(thread_pool_class const &) = delete;
+        thread_pool_class & operator=(thread_pool_class const &) = delete;
+
+        ///  \brief amount of threads that work on a run
+        unsigned size() const {
+            return size_;
+        }
+        ///  \brief calls fct(job) for all job in [0, n_jobs) and returns when all are done
+        ///
+        ///  the order of the jobs and the thread they run on is not specified
+        template<typename F>
+        void run(unsigned const & n_jobs, F fct) {
+            if(size_ == 1 or n_jobs < 2) {
+                for(unsigned job = 0; job < n_jobs; ++job)
+                    fct(job);
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                job_ = fct;
+                n_jobs_ = n_jobs;
+                next_job_ = 0;
+                busy_ = worker_.size();
+                ++generation_;
+            }
+            wake_.notify_all();
+
+            take_jobs();
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [&]() {return busy_ == 0;});
+            job_ = nullptr;
+        }
+    private:
+        ///  \brief takes jobs until none are left
+        void take_jobs() {
+            for(unsigned job = next_job_++; job < n_jobs_; job = next_job_++)
+                job_(job);
+        }
+        ///  \brief main loop of the workers
+        void work() {
+            unsigned seen = 0;
+            while(true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    wake_.wait(lock, [&]() {return stop_ or generation_ != seen;});
+                    if(stop_)
+                        return;
+                    seen = generation_;
+                }
+                take_jobs();
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    --busy_;
+                }
+                done_.notify_one();
+            }
+        }
+    private:
+        unsigned const size_;               ///< threads per run (including the caller)
+        std::vector<std::thread> worker_;   ///< the extra threads
+        std::function<void(unsigned)> job_; ///< the current job
+
+        std::mutex mutex_;
+        std::condition_variable wake_;  ///< signals a new run (or stop) to the workers
+        std::condition_variable done_;  ///< signals the caller that a worker is done
+
+        unsigned generation_;           ///< counts the runs, so that workers don't take a run twice
+        unsigned n_jobs_;               ///< amount of jobs in the current run
+        std::atomic<unsigned> next_job_;///< the next job that is not taken yet
+        unsigned busy_;                 ///< workers that didn't finish the current run
+        bool stop_;                     ///< tells the workers to quit
+    };
+}//end namespace addon
+
+#endif //__THREAD_POOL_MSK_HEADER
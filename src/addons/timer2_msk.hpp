@@ -22,6 +22,7 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 #include <sstream>
 #include <iomanip>
 #include <fstream>
@@ -180,40 +181,23 @@ namespace addon {
         ///  in the data-mode, this will be the title of the rows.
         ///  if the file already exists, it will check, if the names are the same, i.o. to avoid printing different
         ///  data-rows into the same file. a runtime_error will be thrown upon conflict
-        void set_names(   std::string n0 = "empty", std::string n1 = "empty", std::string n2 = "empty", std::string n3 = "empty", std::string n4 = "empty"
-                        , std::string n5 = "empty", std::string n6 = "empty", std::string n7 = "empty", std::string n8 = "empty", std::string n9 = "empty"
-                        ) {
-            if(    n0.find(' ') != std::string::npos or n1.find(' ') != std::string::npos or n2.find(' ') != std::string::npos or n3.find(' ') != std::string::npos or n4.find(' ') != std::string::npos 
-                or n5.find(' ') != std::string::npos or n6.find(' ') != std::string::npos or n7.find(' ') != std::string::npos or n8.find(' ') != std::string::npos or n9.find(' ') != std::string::npos) {
-                throw std::runtime_error("There is a space in a name in the method timer.set_names. Please remove spaces from names.");
+        template<typename... N>
+        void set_names(N const &... names) {
+            std::vector<std::string> in = {std::string(names)...};
+            for(unsigned i = 0; i < in.size(); ++i) {
+                if(in[i].find(' ') != std::string::npos)
+                    throw std::runtime_error("There is a space in a name in the method timer.set_names. Please remove spaces from names.");
             }
             if(written_ == 0) //after a first write it's impossible to change names
             {
-                names_[0] = n0;
-                names_[1] = n1;
-                names_[2] = n2;
-                names_[3] = n3;
-                names_[4] = n4;
-                names_[5] = n5;
-                names_[6] = n6;
-                names_[7] = n7;
-                names_[8] = n8;
-                names_[9] = n9;
+                names_ = in;
                 
                 if(typeid(T) == typeid(data))
                 {
                     std::stringstream o;
                     o << "Time[s]";
-                    if(names_[0] != "empty") o << " " << names_[0];
-                    if(names_[1] != "empty") o << " " << names_[1];
-                    if(n2 != "empty") o << " " << names_[2];
-                    if(n3 != "empty") o << " " << names_[3];
-                    if(n4 != "empty") o << " " << names_[4];
-                    if(n5 != "empty") o << " " << names_[5];
-                    if(n6 != "empty") o << " " << names_[6];
-                    if(n7 != "empty") o << " " << names_[7];
-                    if(n8 != "empty") o << " " << names_[8];
-                    if(n9 != "empty") o << " " << names_[9];
+                    for(unsigned i = 0; i < names_.size(); ++i)
+                        if(names_[i] != "empty") o << " " << names_[i];
                     
                     check_descriptor_line(o.str());
                 }
@@ -332,18 +316,14 @@ namespace addon {
         ///  
         ///  writes to the file depending on the mode. the parameter can be anything that is printable.
         ///  the order of the parameters should be the same as the one in set_names
-        template< typename T0 = not_used, typename T1 = not_used, typename T2 = not_used, typename T3 = not_used, typename T4 = not_used
-                , typename T5 = not_used, typename T6 = not_used, typename T7 = not_used, typename T8 = not_used, typename T9 = not_used
-                >
-        void write(   T0 t0 = not_used(), T1 t1 = not_used(), T2 t2 = not_used(), T3 t3 = not_used(), T4 t4 = not_used()
-                    , T5 t5 = not_used(), T6 t6 = not_used(), T7 t7 = not_used(), T8 t8 = not_used(), T9 t9 = not_used()
-                  ) {
+        template<typename... U>
+        void write(U const &... t) {
             if(typeid(T) == typeid(data)) {
-                data_writer(t0, t1, t2, t3, t4, t5, t6, t7, t8, t9);
+                data_writer(t...);
             }
             else {
                 of_.open(name_.c_str(), std::ios_base::app);
-                normal_writer(of_, t0, t1, t2, t3, t4, t5, t6, t7, t8, t9);
+                normal_writer(of_, t...);
                 of_.close();
             }
         }
@@ -351,13 +331,9 @@ namespace addon {
         ///  
         ///  always prints in normal-mode.
         ///  the order of the parameters should be the same as the one in set_names
-        template< typename T0 = not_used, typename T1 = not_used, typename T2 = not_used, typename T3 = not_used, typename T4 = not_used
-                , typename T5 = not_used, typename T6 = not_used, typename T7 = not_used, typename T8 = not_used, typename T9 = not_used
-                >
-        void print(   T0 t0 = not_used(), T1 t1 = not_used(), T2 t2 = not_used(), T3 t3 = not_used(), T4 t4 = not_used()
-                    , T5 t5 = not_used(), T6 t6 = not_used(), T7 t7 = not_used(), T8 t8 = not_used(), T9 t9 = not_used()
-                  ) {
-            normal_writer(std::cout, t0, t1, t2, t3, t4, t5, t6, t7, t8, t9);
+        template<typename... U>
+        void print(U const &... t) {
+            normal_writer(std::cout, t...);
         }
     private:
         ///  \brief data-mode only
@@ -401,18 +377,13 @@ namespace addon {
         ///  \brief normal-mode
         ///  
         ///  prints the data to os. this is used for print and write (normal-mode)
-        template< typename T0 = not_used, typename T1 = not_used, typename T2 = not_used, typename T3 = not_used, typename T4 = not_used
-                , typename T5 = not_used, typename T6 = not_used, typename T7 = not_used, typename T8 = not_used, typename T9 = not_used
-                >
-        void normal_writer(std::ostream & os = std::cout
-                    , T0 t0 = not_used(), T1 t1 = not_used(), T2 t2 = not_used(), T3 t3 = not_used(), T4 t4 = not_used()
-                    , T5 t5 = not_used(), T6 t6 = not_used(), T7 t7 = not_used(), T8 t8 = not_used(), T9 t9 = not_used()
-                  ) {
+        template<typename... U>
+        void normal_writer(std::ostream & os, U const &... t) {
             timer_date(os);
             int s0 = 20;
             int s1 = 10;
             std::string endl;
-            if(typeid(t4) != typeid(not_used))
+            if(count_used(t...) > 4)
                 endl = "\n";
             else
             {
@@ -425,58 +396,55 @@ namespace addon {
             
             os << std::setw(s0) << "Time[s]" << ": " << std::setw(s1) << elapsed() << endl;
             
-            if(typeid(t0) != typeid(not_used))
-                os << std::setw(s0) << names_[0] << ": " << std::setw(s1) << t0 << endl;
-            if(typeid(t1) != typeid(not_used))
-                os << std::setw(s0) << names_[1] << ": " << std::setw(s1) << t1 << endl;
-            if(typeid(t2) != typeid(not_used))
-                os << std::setw(s0) << names_[2] << ": " << std::setw(s1) << t2 << endl;
-            if(typeid(t3) != typeid(not_used))
-                os << std::setw(s0) << names_[3] << ": " << std::setw(s1) << t3 << endl;
-            if(typeid(t4) != typeid(not_used))
-                os << std::setw(s0) << names_[4] << ": " << std::setw(s1) << t4 << endl;
-            if(typeid(t5) != typeid(not_used))
-                os << std::setw(s0) << names_[5] << ": " << std::setw(s1) << t5 << endl;
-            if(typeid(t6) != typeid(not_used))
-                os << std::setw(s0) << names_[6] << ": " << std::setw(s1) << t6 << endl;
-            if(typeid(t7) != typeid(not_used))
-                os << std::setw(s0) << names_[7] << ": " << std::setw(s1) << t7 << endl;
-            if(typeid(t8) != typeid(not_used))
-                os << std::setw(s0) << names_[8] << ": " << std::setw(s1) << t8 << endl;
-            if(typeid(t9) != typeid(not_used))
-                os << std::setw(s0) << names_[9] << ": " << std::setw(s1) << t9 << endl;
+            normal_line(os, s0, s1, endl, 0, t...);
             if(endl != "\n")
                 os << std::endl;
-            if(os != std::cout)
+            if(&os != &std::cout)
                 ++written_;
         }
+        ///  \brief one line of the normal-mode per value
+        template<typename U, typename... R>
+        void normal_line(std::ostream & os, int const & s0, int const & s1, std::string const & endl, unsigned const & i, U const & t, R const &... rest) {
+            if(typeid(t) != typeid(not_used))
+                os << std::setw(s0) << name_at(i) << ": " << std::setw(s1) << t << endl;
+            normal_line(os, s0, s1, endl, i + 1, rest...);
+        }
+        void normal_line(std::ostream & os, int const & s0, int const & s1, std::string const & endl, unsigned const & i) {
+        }
         ///  \brief data-mode
         ///  
         ///  writes the data into the file. only used by write (data-mode).
         ///  the order of the parameters should be the same as the one in set_names
-        template< typename T0 = not_used, typename T1 = not_used, typename T2 = not_used, typename T3 = not_used, typename T4 = not_used
-                , typename T5 = not_used, typename T6 = not_used, typename T7 = not_used, typename T8 = not_used, typename T9 = not_used
-                >
-        void data_writer(T0 t0 = not_used(), T1 t1 = not_used(), T2 t2 = not_used(), T3 t3 = not_used(), T4 t4 = not_used()
-                     , T5 t5 = not_used(), T6 t6 = not_used(), T7 t7 = not_used(), T8 t8 = not_used(), T9 t9 = not_used()
-                  ) {
+        template<typename... U>
+        void data_writer(U const &... t) {
             of_.open(name_.c_str(), std::ios_base::app);
             of_ << elapsed();
-            if(typeid(t0) != typeid(not_used)) of_ << " " << t0;
-            if(typeid(t1) != typeid(not_used)) of_ << " " << t1;
-            if(typeid(t2) != typeid(not_used)) of_ << " " << t2;
-            if(typeid(t3) != typeid(not_used)) of_ << " " << t3;
-            if(typeid(t4) != typeid(not_used)) of_ << " " << t4;
-            if(typeid(t5) != typeid(not_used)) of_ << " " << t5;
-            if(typeid(t6) != typeid(not_used)) of_ << " " << t6;
-            if(typeid(t7) != typeid(not_used)) of_ << " " << t7;
-            if(typeid(t8) != typeid(not_used)) of_ << " " << t8;
-            if(typeid(t9) != typeid(not_used)) of_ << " " << t9;
+            data_value(t...);
             of_ << std::endl;
             
             ++written_;
             of_.close();
         }
+        ///  \brief one value of the data-mode
+        template<typename U, typename... R>
+        void data_value(U const & t, R const &... rest) {
+            if(typeid(t) != typeid(not_used)) of_ << " " << t;
+            data_value(rest...);
+        }
+        void data_value() {
+        }
+        ///  \brief amount of arguments that are not not_used
+        template<typename U, typename... R>
+        static unsigned count_used(U const & t, R const &... rest) {
+            return (typeid(t) != typeid(not_used)) + count_used(rest...);
+        }
+        static unsigned count_used() {
+            return 0;
+        }
+        ///  \brief the name of the i-th value (empty if there are less names)
+        std::string name_at(unsigned const & i) const {
+            return i < names_.size() ? names_[i] : "empty";
+        }
         
         std::string const name_;
         std::ofstream of_;
@@ -491,7 +459,7 @@ namespace addon {
         #endif
         
         int written_;
-        std::string names_[10];
+        std::vector<std::string> names_;
         std::string comment_;
         double last_print_;
         double last_i_;
@@ -0,0 +1,202 @@
+// Author:  Mario S. Könz <mskoenz@gmx.net>
+// Date:    19.10.2026 13:18:52 EDT
+// File:    bin_store.hpp
+
+#ifndef __BIN_STORE_HEADER
+#define __BIN_STORE_HEADER
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <stdint.h>
+#include <assert.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//perimeter is documented in grid_class.hpp
+namespace perimeter_rvb {
+    namespace detail {
+        char const bin_magic[8] = {'R', 'V', 'B', 'B', 'I', 'N', 'S', '1'};
+        ///  \brief the header of a bin file, followed by the names and the records
+        struct bin_header_struct {
+            char magic[8];
+            uint32_t n_obs;     ///< doubles per record
+            uint32_t offset;    ///< byte offset of the first record (header + names, multiple of 8)
+        };
+    }//end namespace detail
+    ///  \brief append-only binary file with one record of n_obs doubles per bin
+    ///
+    ///  push_back only buffers, flush appends the buffer to the file. The file starts with a header
+    ///  that holds the names of the observables, s.t. the file can be read without the simulation.
+    ///  A file with another header (e.g. from a run with other swap regions) is never appended to.
+    class bin_store_class {
+        enum header_enum {no_file, own_header, foreign_header};
+    public:
+        ///  \brief the only constructor
+        ///
+        ///  @param name is the file
+        ///  @param names are the names of the observables in a record (no spaces)
+        bin_store_class(std::string const & name, std::vector<std::string> const & names): name_(name), names_(names) {
+        }
+        ///  \brief buffers one record
+        void push_back(std::vector<double> const & record) {
+            assert(record.size() == names_.size());
+            buffer_.insert(buffer_.end(), record.begin(), record.end());
+        }
+        ///  \brief appends the buffered records to the file and writes the header if the file is new
+        ///
+        ///  throws if the file has the header of other observables
+        void flush() {
+            check_header();
+            std::ofstream ofs(name_, std::ios::binary | std::ios::app);
+            if(ofs.tellp() == 0)
+                write_header(ofs);
+            ofs.write(reinterpret_cast<char const *>(buffer_.data()), buffer_.size() * sizeof(double));
+            ofs.close();
+            buffer_.clear();
+        }
+        ///  \brief deletes the file and the buffer
+        void remove() {
+            std::remove(name_.c_str());
+            buffer_.clear();
+        }
+        ///  \brief amount of records in the file and the buffer
+        uint64_t size() const {
+            return stored() + buffer_.size() / names_.size();
+        }
+        ///  \brief drops the buffer and all records of the file after the first n
+        ///
+        ///  used after loading a checkpoint, the records written after it are written again. A file with the
+        ///  header of other observables is removed for n == 0 (a new run) and throws otherwise
+        void truncate(uint64_t const & n) {
+            buffer_.clear();
+            if(n == 0 and header() == foreign_header)
+                std::remove(name_.c_str());
+            if(stored() > n and ::truncate(name_.c_str(), header_size() + n * names_.size() * sizeof(double)) != 0)
+                throw std::runtime_error("bin_store_class: cannot truncate " + name_);
+        }
+        std::string const & name() const {
+            return name_;
+        }
+    private:
+        ///  \brief amount of complete records in the file
+        uint64_t stored() const {
+            check_header();
+            struct stat st;
+            if(stat(name_.c_str(), &st) != 0 or uint64_t(st.st_size) < header_size())
+                return 0;
+            return (st.st_size - header_size()) / (names_.size() * sizeof(double));
+        }
+        ///  \brief the names padded to a multiple of 8 bytes
+        std::string padded_names() const {
+            std::stringstream ss;
+            for(unsigned i = 0; i < names_.size(); ++i)
+                ss << names_[i] << " ";
+            std::string names = ss.str();
+            names.resize((names.size() + 7) / 8 * 8, ' ');
+            return names;
+        }
+        ///  \brief bytes before the first record
+        uint64_t header_size() const {
+            return sizeof(detail::bin_header_struct) + padded_names().size();
+        }
+        ///  \brief if the file is missing (or empty), starts with the header of names_ or with another one
+        header_enum header() const {
+            std::ifstream ifs(name_, std::ios::binary);
+            if(not ifs or ifs.peek() == std::char_traits<char>::eof())
+                return no_file;
+            std::stringstream expected;
+            write_header(expected);
+            std::string found(expected.str().size(), 0);
+            ifs.read(&found[0], found.size());
+            return (ifs and found == expected.str()) ? own_header : foreign_header;
+        }
+        void check_header() const {
+            if(header() == foreign_header)
+                throw std::runtime_error("bin_store_class: " + name_ + " holds the bins of other observables (use -del)");
+        }
+        void write_header(std::ostream & os) const {
+            std::string names = padded_names();
+
+            detail::bin_header_struct h;
+            std::memcpy(h.magic, detail::bin_magic, 8);
+            h.n_obs = names_.size();
+            h.offset = sizeof(h) + names.size();
+            os.write(reinterpret_cast<char const *>(&h), sizeof(h));
+            os.write(names.data(), names.size());
+        }
+    private:
+        std::string const name_;
+        std::vector<std::string> const names_;
+        std::vector<double> buffer_; ///< records that are not in the file yet
+    };
+    ///  \brief read-only memory map of a file written by bin_store_class
+    ///
+    ///  throws a runtime_error if the file cannot be mapped or is not a bin file
+    class bin_view_class {
+    public:
+        bin_view_class(std::string const & name): data_(nullptr), size_(0) {
+            int fd = open(name.c_str(), O_RDONLY);
+            if(fd == -1)
+                throw std::runtime_error("bin_view_class: cannot open " + name);
+            struct stat st;
+            fstat(fd, &st);
+            size_ = st.st_size;
+            if(size_ >= sizeof(detail::bin_header_struct))
+                data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+
+            if(data_ == nullptr or data_ == MAP_FAILED or std::memcmp(header().magic, detail::bin_magic, 8) != 0 
+               or header().offset > size_ or header().n_obs == 0) {
+                release();
+                throw std::runtime_error("bin_view_class: " + name + " is not a bin file");
+            }
+            std::stringstream ss(std::string(static_cast<char const *>(data_) + sizeof(detail::bin_header_struct)
+                                           , header().offset - sizeof(detail::bin_header_struct)));
+            std::string n;
+            while(ss >> n)
+                names_.push_back(n);
+        }
+        ~bin_view_class() {
+            release();
+        }
+        bin_view_class(bin_view_class const &) = delete;
+        bin_view_class & operator=(bin_view_class const &) = delete;
+
+        ///  \brief amount of complete records
+        uint64_t size() const {
+            return (size_ - header().offset) / (n_obs() * sizeof(double));
+        }
+        unsigned n_obs() const {
+            return header().n_obs;
+        }
+        std::vector<std::string> const & names() const {
+            return names_;
+        }
+        ///  \brief pointer to the n_obs values of record i
+        double const * operator[](uint64_t const & i) const {
+            return reinterpret_cast<double const *>(static_cast<char const *>(data_) + header().offset) + i * n_obs();
+        }
+    private:
+        detail::bin_header_struct const & header() const {
+            return *static_cast<detail::bin_header_struct const *>(data_);
+        }
+        void release() {
+            if(data_ != nullptr and data_ != MAP_FAILED)
+                munmap(data_, size_);
+            data_ = nullptr;
+        }
+    private:
+        void * data_;   ///< the mapped file
+        uint64_t size_; ///< size of the file in bytes
+        std::vector<std::string> names_;
+    };
+}//end namespace perimeter_rvb
+#endif //__BIN_STORE_HEADER
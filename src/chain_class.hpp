@@ -0,0 +1,163 @@
+// Author:  Mario S. Könz <mskoenz@gmx.net>
+// Date:    19.10.2026 15:02:11 EDT
+// File:    chain_class.hpp
+
+#ifndef __CHAIN_CLASS_HEADER
+#define __CHAIN_CLASS_HEADER
+
+#include <sim_class.hpp>
+#include <shift_region_class.hpp>
+
+#include <timer2_msk.hpp>
+#include <immortal_msk.hpp>
+#include <thread_pool_msk.hpp>
+
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <cmath>
+
+//perimeter is documented in grid_class.hpp
+namespace perimeter_rvb {
+    ///  \brief the increment trick in one process
+    ///
+    ///  The shift file holds the regions A_0, A_1, ..., A_N. Link k is a sim_class with A_k as preswap and
+    ///  A_k+1 as swap region and measures the increment S2(A_k+1) - S2(A_k). The links are independent
+    ///  simulations, so the cumulative S2 is the sum of the increments and the errors add in quadrature.
+    ///
+    ///  The links run in parallel on param["threads"] threads (each link then uses one thread), or in
+    ///  sequence with the threads inside of every link. After the thermalization they run in rounds of one bin,
+    ///  between two rounds a checkpoint of all links is written like in sim_class::run (addon::immortal).
+    class chain_class {
+        typedef addon::bash_parameter_class::map_type map_type; ///< just forwarding from bash_parameter
+
+        ///  \brief the regions k and k+1 of a shift file as preswap and swap region
+        struct link_region_struct {
+            link_region_struct(shift_region_class const & full, unsigned const & k): full(full), k(k) {
+            }
+            unsigned size() const {
+                return 2;
+            }
+            unsigned operator()(unsigned const & n, unsigned const & i, unsigned const & j) const {
+                return full(k + n, i, j);
+            }
+            shift_region_class const & full;
+            unsigned const k;
+        };
+        ///  \brief the thermalization of the links doesn't print progress
+        struct silent_timer_struct {
+            void progress(uint64_t const & i, unsigned const & mode) {
+            }
+        };
+    public:
+        ///  \brief the only constructor
+        ///
+        ///  @param param is a map that contains the bash parameters, see sim_class
+        chain_class(map_type const & param):  param_(param)
+                                            , region_(std::string(param_["shift"]))
+                                            , pool_(std::min(unsigned(param_["threads"]), region_.size() - 1)) {
+            map_type link_param = param_;
+            if(pool_.size() > 1)
+                link_param["threads"] = 1;
+
+            for(unsigned k = 0; k + 1 < region_.size(); ++k)
+                link_.push_back(std::unique_ptr<sim_class>(new sim_class(link_param, link_region_struct(region_, k))));
+        }
+        ///  \brief runs all links and writes one results row per link with the cumulative S2
+        ///  
+        ///  continues from the checkpoint if there is one (-del removes it), a checkpoint is written every
+        ///  param["checkpoint_seconds"] (default 300) and at the end
+        void run() {
+            unsigned const n = link_.size();
+            uint64_t const sim = param_["sim"];
+
+            addon::timer_class<addon::data> timer(n, param_["res"]);
+            timer.set_names("seed"
+                          , "H"
+                          , "L"
+                          , "therm"
+                          , "sim"
+                          , "x"
+                          , "link"
+                          , "increment"
+                          , "increment_error"
+                          , "entropy"
+                          , "error"
+                          );
+
+            if(param_.find("del") != param_.end())
+                addon::immortal.reset();
+            addon::immortal.set_signature(signature());
+            if(addon::immortal.available()) {
+                std::cout << GREENB << "load data at index " << addon::immortal.get_index() << NONE << std::endl;
+                addon::immortal >> (*this);
+            }
+            else
+                pool_.run(n,
+                    [&](unsigned const & k) {
+                        silent_timer_struct silent;
+                        link_[k]->thermalize(silent);
+                    }
+                );
+
+            auto const checkpoint_interval = sim_class::checkpoint_interval(param_);
+            auto next_checkpoint = std::chrono::steady_clock::now() + checkpoint_interval;
+            for(uint64_t first = addon::immortal.get_index(0); first < sim; ) {
+                uint64_t const last = std::min(sim, (first | ((1lu<<10) - 1)) + 1); //the end of the bin
+                pool_.run(n,
+                    [&](unsigned const & k) {
+                        sim_class & link = *link_[k];
+                        for(uint64_t i = first; i < last; ++i) {
+                            link.update();
+                            link.measure();
+                            if((i & ((1lu<<10) - 1)) == ((1lu<<10) - 1)) //same bins as sim_class::run
+                                link.close_bin();
+                        }
+                    }
+                );
+                first = last;
+                if(first == sim or std::chrono::steady_clock::now() >= next_checkpoint) {
+                    addon::immortal << (*this);
+                    addon::immortal.write_next_index(first);
+                    next_checkpoint = std::chrono::steady_clock::now() + checkpoint_interval;
+                }
+            }
+
+            double entropy = 0;
+            double var = 0;
+            for(unsigned k = 0; k < n; ++k) {
+                std::pair<double, double> const inc = link_[k]->entropy();
+                entropy += inc.first;
+                var += inc.second * inc.second;
+                timer.write(addon::global_seed.get()
+                            , param_["H"]
+                            , param_["L"]
+                            , link_[k]->therm_used()
+                            , sim
+                            , param_["g"]
+                            , k
+                            , inc.first
+                            , inc.second
+                            , entropy
+                            , std::sqrt(var)
+                            );
+            }
+        }
+        ///  \brief describes what a checkpoint of the chain holds (see immortal_class::set_signature)
+        std::string signature() const {
+            return "chain of " + std::to_string(link_.size()) + " links, " + link_[0]->signature();
+        }
+        ///  \brief for the checkpoints, all links one after the other
+        template<typename Archive>
+        void serialize(Archive & ar) {
+            for(unsigned k = 0; k < link_.size(); ++k)
+                ar & (*link_[k]);
+        }
+    private:
+        map_type param_;                ///< the parameter with all the settings
+        shift_region_class region_;     ///< A_0 to A_N
+        addon::thread_pool_class pool_; ///< runs the links in parallel
+        std::vector<std::unique_ptr<sim_class>> link_; ///< link k measures A_k -> A_k+1
+    };
+}//end namespace perimeter_rvb
+#endif //__CHAIN_CLASS_HEADER
@@ -6,6 +6,8 @@
 #define __GRID_CLASS_HEADER
 
 #include <site_struct.hpp>
+#include <addons/fft_msk.hpp>
+#include <addons/serialize/serializer.hpp>
 
 #include <boost/integer.hpp>
 #include <boost/multi_array.hpp>
@@ -14,6 +16,7 @@
 #include <memory>
 #include <vector>
 #include <iomanip>
+#include <numeric>
 #include <iostream>
 #include <algorithm>
 
@@ -58,7 +61,9 @@ namespace perimeter_rvb {
               , L_(L)
               , grid_(boost::extents[H_][L_])
               , n_loops_(0)
-              , shift_mode_(qmc::no_shift) {
+              , shift_mode_(qmc::no_shift)
+              , crossing2_(qmc::n_states, 0)
+              , dimer_fft_(H, L) {
             
             //just make sure that the input is sensible
             assert(H_>0);
@@ -85,11 +90,17 @@ namespace perimeter_rvb {
             init_loops();
             
             copy_to_ket();
+            
+            init_winding();
         }
         ///  \brief resets the check flag for all sites in all states
         ///  
         ///  Whenever an operation is performed that concernes the whole grid, visited sites will be flaged as checked.
         ///  At the end of the operation (e.g. init_loops) one has to clear this flags
+        ///  
+        ///  Like clear_tile_spin and copy_to_ket this visits every site once and does all states there. A site holds
+        ///  the neighbors, tiles and all states together, so these passes stride over sizeof(site_type) and are bound
+        ///  by memory, not by the instruction set. Vector paths would need the fields per state in arrays of their own
         void clear_check(){
             std::for_each(begin(), end(), 
                 [&](site_type & s) {
@@ -124,22 +135,123 @@ namespace perimeter_rvb {
         ///  
         ///  The function returns true if the update was successful, false otherwise
         bool two_bond_update_intern(unsigned const & i, unsigned const & j, state_type const & state, unsigned const & tile) {
-            return grid_[i][j].tile_update(state, tile);
+            bond_observer_struct obs(*this);
+            return grid_[i][j].tile_update(state, tile, obs);
+        }
+        ///  \brief nonlocal bond update along a closed path of alternating old and new bonds
+        ///
+        ///  @param i is the height coordinate of the start site (tail)
+        ///  @param j is the length coordinate of the start site (tail)
+        ///  @param state specifies in what bra or ket the update should be tried
+        ///  @param rng must return a double in [0, 1)
+        ///  @param max_len is the amount of steps after which the update is rejected
+        ///  @param trace is a buffer that keeps the old bonds in order to undo a rejected update
+        ///
+        ///  The bond of the tail is broken up and the free end (head) walks through the layer: it picks one of its
+        ///  neighbors at random, forms a bond with it and the old partner of the neighbor becomes the new head. The
+        ///  update closes when the head picks the tail. A neighbor with the same spin as the head is not allowed
+        ///  (the step is wasted), so all bonds keep connecting opposite spins. All proposals have the probability
+        ///  1/(n_bonds - start_bond), so the reverse path has the same probability and detailed balance holds.
+        ///
+        ///  Returns the amount of bonds that were written on the path, 0 if rejected or if the path retraced itself
+        ///  s.t. no bond changed (e.g. the head picks the tail in the first step)
+        template<typename RNG>
+        unsigned loop_bond_update_intern(unsigned const & i, unsigned const & j, state_type const & state, RNG & rng
+                                       , unsigned const & max_len, std::vector<std::pair<site_type *, bond_type>> & trace) {
+            unsigned const n_dir = qmc::n_bonds - qmc::start_bond;
+
+            site_type * const tail = &grid_[i][j];
+            site_type * head = tail->partner(state);
+
+            trace.clear();
+            trace.push_back(std::make_pair(tail, tail->bond[state]));
+
+            for(unsigned step = 0; step < max_len; ++step) {
+                bond_type const dir = qmc::start_bond + bond_type(rng() * n_dir);
+                site_type * const next = head->neighbor[dir];
+
+                if(next->spin[state] == head->spin[state])
+                    continue;
+
+                site_type * const old = next->partner(state);
+
+                trace.push_back(std::make_pair(head, head->bond[state]));
+                trace.push_back(std::make_pair(next, next->bond[state]));
+                head->bond[state] = dir;
+                next->bond[state] = qmc::invert_bond - dir;
+
+                if(next == tail) {
+                    if(unchanged(state, trace))
+                        return 0;
+                    refresh_tiles(state, trace);
+                    count_bonds(state, trace);
+                    return trace.size() - 1;
+                }
+                head = old;
+            }
+            //------------------- too long, undo everything -------------------
+            for(auto it = trace.rbegin(); it != trace.rend(); ++it)
+                it->first->bond[state] = it->second;
+            return 0;
+        }
+        ///  \brief amount of bonds in state that cross the border of the selected swap region
+        ///  
+        ///  kept up to date by the bond updates, ln(2) times its mean is the valence bond entanglement entropy of
+        ///  the sampled ensemble (of the plain RVB state if the preswap region is empty)
+        double crossing(state_type const & state) const {
+            return crossing2_[state] * .5;
+        }
+        ///  \brief crossing averaged over all states
+        double crossing() const {
+            return std::accumulate(crossing2_.begin(), crossing2_.end(), 0) * .5 / qmc::n_states;
+        }
+        ///  \brief counts the crossing bonds of all states from scratch, O(H*L)
+        void init_crossing() {
+            crossing2_ = std::vector<int>(qmc::n_states, 0);
+            crossing_observer_struct obs(crossing2_);
+            for(state_type state = qmc::start_state; state < qmc::n_states; ++state)
+                std::for_each(begin(), end(), 
+                    [&](site_type & s) {
+                        obs(state, &s, s.partner(state), 1); //every bond is seen from both ends
+                    }
+                );
+        }
+        ///  \brief winding number of state through the periodic boundary in j (dir 0) or in i (dir 1)
+        ///  
+        ///  On the bipartite grids (sqr, hex) the bonds through the boundary count +1 or -1 depending on the
+        ///  sublattice of their site in the last column (row), on tri only the parity of their amount is conserved.
+        ///  The tile updates never change it (the winding sector), only the loop_bond_update does. Kept up to
+        ///  date by the bond updates, needs H and L larger than 2
+        int winding(state_type const & state, unsigned const & dir) const {
+            int const w = wind2_[2 * state + dir] / 2;
+            return qmc::n_bonds == qmc::tri ? w % 2 : w;
+        }
+        ///  \brief counts the winding numbers of all states from scratch, O(H*L)
+        void init_winding() {
+            wind2_ = std::vector<int>(2 * qmc::n_states, 0);
+            winding_observer_struct obs(*this);
+            for(state_type state = qmc::start_state; state < qmc::n_states; ++state)
+                std::for_each(begin(), end(), 
+                    [&](site_type & s) {
+                        obs(state, &s, s.partner(state), 1); //every bond is seen from both ends
+                    }
+                );
         }
         ///  \brief reset the spin-checked-flags on the tiles
         ///  
         ///  After a spinupdate, the tiles have to be checked again if they are now or still updateable.
-        ///  Clearing this bit will not check for that, but enable the check if a tile is visited
+        ///  Clearing this bit will not check for that, but enable the check if a tile is visited.
+        ///  All states are done in one pass over the grid
         void clear_tile_spin() {
-            for(state_type state = qmc::start_state; state < qmc::n_states; ++state) {
-                std::for_each(begin(), end(), 
-                    [&](site_type & s) {
+            std::for_each(begin(), end(), 
+                [&](site_type & s) {
+                    for(state_type state = qmc::start_state; state < qmc::n_states; ++state) {
                         for(unsigned i = 0; i < tile_type::tile_per_site; ++i) {
                             CLEAR_BIT(s.tile[state][i].alpha, qmc::clear)
                         }
                     }
-                );
-            }
+                }
+            );
         }
         ///  \brief change from no swap to preswap or swap
         ///  
@@ -152,44 +264,120 @@ namespace perimeter_rvb {
         }
         ///  \brief writes the "shift matrix" to the sites
         ///  
-        ///  Any object that has an operator()(size_t, size_t, size_t) and is equal or larger that the
-        ///  works in here. The information is just transfered to the sites
-        template<typename T> //T must suport an operator()(size_t, size_t, size_t)
+        ///  Any object that has an operator()(size_t, size_t, size_t) and a size() and is equal or larger that the
+        ///  works in here. Region 0 is the preswap, all further regions are swap regions. They are stored in the grid and
+        ///  the first one is transfered to the sites, see select_swap_region
+        template<typename T> //T must suport an operator()(size_t, size_t, size_t) and size()
         void set_shift_region(T const & region) {
-            for(shift_type shift_mode = qmc::start_shift; shift_mode != qmc::n_shifts; ++shift_mode)
+            swap_region_.clear();
+            for(shift_type n = qmc::ket_swap; n < region.size(); ++n) {
+                swap_region_.push_back(std::vector<shift_type>());
                 for(index_type i = 0; i < H_; ++i)
                     for(index_type j = 0; j < L_; ++j)
-                        grid_[i][j].shift_region[shift_mode] = region(shift_mode, i, j);
+                        swap_region_.back().push_back(region(n, i, j));
+            }
+            for(index_type i = 0; i < H_; ++i)
+                for(index_type j = 0; j < L_; ++j)
+                    grid_[i][j].shift_region[qmc::ket_preswap] = region(qmc::ket_preswap, i, j);
+            select_swap_region(0);
+        }
+        ///  \brief amount of swap regions
+        unsigned n_swap_regions() const {
+            return swap_region_.size();
+        }
+        ///  \brief the swap region k is used in the ket_swap shift_mode from now on
+        void select_swap_region(unsigned const & k) {
+            std::vector<shift_type> const & region = swap_region_[k];
+            std::for_each(begin(), end(), 
+                [&](site_type & s) {
+                    s.shift_region[qmc::ket_swap] = region[&s - begin()];
+                }
+            );
+            init_crossing();
+        }
+        ///  \brief the swap region k is used in the ket_preswap shift_mode from now on
+        ///  
+        ///  the spins need to be made consistent with the new loops afterwards (see sim_class::respin)
+        void select_preswap_region(unsigned const & k) {
+            std::vector<shift_type> const & region = swap_region_[k];
+            std::for_each(begin(), end(), 
+                [&](site_type & s) {
+                    s.shift_region[qmc::ket_preswap] = region[&s - begin()];
+                }
+            );
+        }
+        ///  \brief takes over all shift regions of other (same H and L), e.g. for a measurement grid
+        void copy_shift_region(grid_class & other) {
+            swap_region_ = other.swap_region_;
+            for(index_type i = 0; i < H_ * L_; ++i)
+                for(shift_type n = 0; n < qmc::n_shifts; ++n)
+                    begin()[i].shift_region[n] = other.begin()[i].shift_region[n];
+            init_crossing();
+        }
+        ///  \brief compact copy of a configuration: everything init_loops needs, and the spins
+        struct snapshot_struct {
+            std::vector<bond_type> bond; ///< n_states bonds per site
+            std::vector<spin_type> spin; ///< n_states spins per site
+            shift_type shift_mode;
+        };
+        ///  \brief writes bonds, spins and shift_mode to snap (reuses its memory)
+        void save_snapshot(snapshot_struct & snap) {
+            snap.bond.resize(H_ * L_ * qmc::n_states);
+            snap.spin.resize(H_ * L_ * qmc::n_states);
+            for(index_type i = 0; i < H_ * L_; ++i)
+                for(state_type state = qmc::start_state; state < qmc::n_states; ++state) {
+                    snap.bond[i * qmc::n_states + state] = begin()[i].bond[state];
+                    snap.spin[i * qmc::n_states + state] = begin()[i].spin[state];
+                }
+            snap.shift_mode = shift_mode_;
+        }
+        ///  \brief sets bonds, spins and shift_mode from snap
+        ///  
+        ///  the tiles are not updated, so the grid can measure but not be updated afterwards
+        void load_snapshot(snapshot_struct const & snap) {
+            load_snapshot(snap.bond.data(), snap.spin.data(), snap.shift_mode);
+        }
+        ///  \brief like load_snapshot, with the n_states bonds and spins per site at bond and spin
+        void load_snapshot(bond_type const * bond, spin_type const * spin, shift_type const & shift_mode) {
+            for(index_type i = 0; i < H_ * L_; ++i)
+                for(state_type state = qmc::start_state; state < qmc::n_states; ++state) {
+                    begin()[i].bond[state] = bond[i * qmc::n_states + state];
+                    begin()[i].spin[state] = spin[i * qmc::n_states + state];
+                }
+            set_shift_mode(shift_mode);
+            init_crossing();
+            init_winding();
         }
         ///  \brief copies spins from bra to ket
         ///  
         ///  In case of no shift, the ket_spins are the same as the corresponding bra_spins.
         ///  If a shift is set, it will permute the spins accordingly. It's just a trick
         ///  for a nicer implementation, so that the two_bond_update doesn't have to "jump"
-        ///  between layers (states)
+        ///  between layers (states). All bras are done in one pass over the grid
         void copy_to_ket() {
             if(shift_mode_ == qmc::no_shift) {
-                for(state_type bra = qmc::start_state; bra < qmc::n_bra; ++bra) {
-                    std::for_each(begin(), end(), 
-                        [&](site_type & s) {
+                std::for_each(begin(), end(), 
+                    [&](site_type & s) {
+                        for(state_type bra = qmc::start_state; bra < qmc::n_bra; ++bra) {
                             state_type const ket = qmc::invert_state - bra;
                             s.spin[ket] = s.spin[bra];
                         }
-                    );
-                }
+                    }
+                );
             }
             else {
-                for(state_type bra = qmc::start_state; bra < qmc::n_bra; ++bra) {
-                    std::for_each(begin(), end(), 
-                        [&](site_type & s) {
+                shift_type const mode = shift_mode_;
+                std::for_each(begin(), end(), 
+                    [&](site_type & s) {
+                        for(state_type bra = qmc::start_state; bra < qmc::n_bra; ++bra) {
                             state_type const ket = qmc::invert_state - bra;
-                            state_type effective_bra = bra + (qmc::n_bra - s.shift_region[shift_mode_]);
+                            state_type effective_bra = bra + (qmc::n_bra - s.shift_region[mode]);
                             if(effective_bra >= qmc::n_bra)//lazy boundary for now
                                 effective_bra -= qmc::n_bra;
                             s.spin[ket] = s.spin[effective_bra];
                         }
-                    );
-                }
+                    }
+                );
             }
         }
         
@@ -205,6 +393,13 @@ namespace perimeter_rvb {
         ///  
         ///  the sign of the total config as well as the number of "negative" loops is also captured
         void init_loops() {
+            init_loops([](loop_type const & length, state_type const & bra) {});
+        }
+        ///  \brief same as above, but calls loop_fct(length, bra) after every loop
+        ///  
+        ///  length is the amount of sites on the loop (summed over all layers it passes) and bra the layer where it starts
+        template<typename F>
+        void init_loops(F loop_fct) {
             n_loops_ = 0;
             n_neg_loops_ = 0;
             sign_ = +1;
@@ -218,9 +413,11 @@ namespace perimeter_rvb {
                             alternator_ = bra; //must be bra, not ket, see subsign *= -1 below
                             auto old_bra = bra;
                             site_type::last_dir = 0;
+                            loop_type length = 0;
                             
                             follow_loop_tpl(&s, bra, 
                                 [&](site_type * next){
+                                    ++length;
                                     next->check[bra] = true;
                                     next->loop[bra] = n_loops_;
                                     assert(alternator_ == bra or alternator_ == qmc::invert_state - bra);
@@ -245,6 +442,7 @@ namespace perimeter_rvb {
                                 sign_ *= -1;
                             }
                             
+                            loop_fct(length, bra);
                             ++n_loops_;
                         }
                     }
@@ -263,6 +461,109 @@ namespace perimeter_rvb {
         int const & sign() const {
             return sign_;
         }
+        ///  \brief improved estimator of the spin correlations from the loops of the last init_loops
+        ///
+        ///  Two sites on the same loop have <S_i.S_j> = 3/4 (-1)^(steps between them along the loop), sites on
+        ///  different loops are uncorrelated. The spins alternate along every loop, so the sign is just the
+        ///  product of the two spins. corr[di * L + dj] is set to the estimator of <S_i.S_i+(di, dj)> averaged over
+        ///  all sites i (in index coordinates, periodic) and bra layers. Costs the sum of the squared loop sizes
+        ///  
+        ///  With a shift, a loop can pass through several bra layers (replicas). Only pairs in the same layer
+        ///  are counted, a pair of two replicas is no correlation within one of them
+        void spin_correlation(std::vector<double> & corr) const {
+            struct member_struct {
+                index_type i;
+                index_type j;
+                state_type bra;
+                int sign;
+            };
+            //counting sort of the sites by their loop label
+            std::vector<index_type> first(n_loops_ + 1, 0);
+            for(state_type bra = qmc::start_state; bra < qmc::n_bra; ++bra)
+                for(index_type i = 0; i < H_; ++i)
+                    for(index_type j = 0; j < L_; ++j)
+                        ++first[grid_[i][j].loop[bra] + 1];
+            std::partial_sum(first.begin(), first.end(), first.begin());
+
+            std::vector<member_struct> member(first.back());
+            std::vector<index_type> fill(first.begin(), first.end() - 1);
+            for(state_type bra = qmc::start_state; bra < qmc::n_bra; ++bra)
+                for(index_type i = 0; i < H_; ++i)
+                    for(index_type j = 0; j < L_; ++j) {
+                        site_type const & s = grid_[i][j];
+                        member_struct & m = member[fill[s.loop[bra]]++];
+                        m.i = i;
+                        m.j = j;
+                        m.bra = bra;
+                        m.sign = s.spin[bra] == qmc::alpha ? 1 : -1;
+                    }
+
+            corr.assign(H_ * L_, 0);
+            double const norm = .75 / (qmc::n_bra * H_ * L_);
+            for(loop_type l = 0; l < n_loops_; ++l)
+                for(index_type begin = first[l]; begin < first[l + 1]; ) {
+                    //the bras were filled in after each other, so the members of a loop in one layer are contiguous
+                    index_type end = begin;
+                    while(end < first[l + 1] and member[end].bra == member[begin].bra)
+                        ++end;
+                    for(index_type a = begin; a < end; ++a)
+                        for(index_type b = begin; b < end; ++b) {
+                            member_struct const & ma = member[a];
+                            member_struct const & mb = member[b];
+                            index_type const di = (mb.i + H_ - ma.i) % H_;
+                            index_type const dj = (mb.j + L_ - ma.j) % L_;
+                            corr[di * L_ + dj] += norm * ma.sign * mb.sign;
+                        }
+                    begin = end;
+                }
+        }
+        ///  \brief amount of bond directions of the dimer fields, see dimer_dir
+        static unsigned const n_dimer_dirs = qmc::n_bonds == qmc::tri ? 3 : 2;
+        ///  \brief the dimer field of a bond of site (i, j): 0 down, 1 right (hori on hex), 2 diag_down
+        ///
+        ///  returns n_dimer_dirs if the bond is counted at its other end, s.t. every bond is counted once
+        static unsigned dimer_dir(bond_type const & bond, index_type const & i, index_type const & j) {
+            if(bond == qmc::down)
+                return 0;
+            if(bond == qmc::right or (bond == qmc::hori and (i + j) % 2 == 0))
+                return 1;
+            if(bond == qmc::diag_down)
+                return 2;
+            return n_dimer_dirs;
+        }
+        ///  \brief dimer structure factor of every bond direction, averaged over all states
+        ///
+        ///  n_d(i, j) is 1 if site (i, j) has a bond in direction d (see dimer_dir). sf[d * H * L + qi * L + qj] is
+        ///  set to |sum_ij exp(-2 pi i (qi i / H + qj j / L)) n_d(i, j)|^2 / (H * L), i.e. q = 0 holds the squared
+        ///  amount of bonds. Two real fields share one complex fft, so it costs n_states * n_dimer_dirs / 2 ffts.
+        ///  The fields and fft buffers stay in dimer_ws_, so only the first call allocates
+        void dimer_structure_factor(std::vector<double> & sf) const {
+            index_type const N = H_ * L_;
+            std::vector<std::vector<double>> & field = dimer_ws_.field;
+            field.resize(qmc::n_states * n_dimer_dirs + (qmc::n_states * n_dimer_dirs) % 2, std::vector<double>(N));
+            for(auto & f: field)
+                std::fill(f.begin(), f.end(), 0);
+            for(index_type i = 0; i < H_; ++i)
+                for(index_type j = 0; j < L_; ++j)
+                    for(state_type state = qmc::start_state; state < qmc::n_states; ++state) {
+                        unsigned const d = dimer_dir(grid_[i][j].bond[state], i, j);
+                        if(d < n_dimer_dirs)
+                            field[state * n_dimer_dirs + d][i * L_ + j] = 1;
+                    }
+
+            sf.assign(n_dimer_dirs * N, 0);
+            std::vector<std::complex<double>> & fa = dimer_ws_.fa;
+            std::vector<std::complex<double>> & fb = dimer_ws_.fb;
+            double const norm = 1. / (qmc::n_states * N);
+            for(unsigned f = 0; f < field.size(); f += 2) {
+                dimer_fft_.real_pair(field[f], field[f + 1], fa, fb, dimer_ws_.fft);
+                for(index_type q = 0; q < N; ++q) {
+                    sf[f % n_dimer_dirs * N + q] += norm * std::norm(fa[q]);
+                    if(f + 1 < qmc::n_states * n_dimer_dirs)
+                        sf[(f + 1) % n_dimer_dirs * N + q] += norm * std::norm(fb[q]);
+                }
+            }
+        }
         //=================== print and iterate ===================
         ///  \brief prints the sites accordung to the site.print fct
         ///  
@@ -367,13 +668,36 @@ namespace perimeter_rvb {
         }
         ///  \brief for the checkpoints
         ///  
-        ///  this function is used by the serializer to get and set this object
+        ///  this function is used by the serializer to get and set this object. Only the bonds and spins are
+        ///  stored, as two compact arrays (see snapshot_struct and serialize_view). In a checkpoint they are raw
+        ///  sections that are applied straight from the mapped file (see immortal_class). The rest of a site is
+        ///  either set up by the constructor (neighbors, shift regions, tiles) or rebuilt here: the tiles are
+        ///  refreshed from the bonds, loop labels and checks are only valid between init_loops and clear_check.
         template<typename Archive>
         void serialize(Archive & ar) {
             ar & n_loops_;
             ar & alternator_;
             ar & shift_mode_;
-            ar & grid_;
+            snapshot_struct snap;
+            bond_type const * bond = nullptr;
+            spin_type const * spin = nullptr;
+            if(Archive::type == archive_enum::output) {
+                save_snapshot(snap);
+                bond = snap.bond.data();
+                spin = snap.spin.data();
+            }
+            addon::serialize_view(ar, bond, snap.bond, H_ * L_ * qmc::n_states);
+            addon::serialize_view(ar, spin, snap.spin, H_ * L_ * qmc::n_states);
+            if(Archive::type == archive_enum::input) {
+                load_snapshot(bond, spin, shift_mode_);
+                for(state_type state = qmc::start_state; state < qmc::n_states; ++state)
+                    std::for_each(begin(), end(), 
+                        [&](site_type & s) {
+                            for(unsigned t = 0; t < tile_type::tile_per_site; ++t)
+                                s.tile[state][t].refresh();
+                        }
+                    );
+            }
         }
     private:
         ///  \brief initializes the periodic neighbor structur as well as the initial state
@@ -382,45 +706,7 @@ namespace perimeter_rvb {
         ///  
         ///  is only used by the constructor thus private
         void init_grid(std::vector<unsigned> const init) {
-            int state = 0;
-            
-            for(state_type bra = qmc::start_state; bra < qmc::n_bra; ++bra) {
-                state = 0;
-                std::for_each(begin(), end(), 
-                    [&](site_type & s) {
-                        state_type ket = qmc::invert_state - bra;
-                        s.spin[bra] = (state + state / L_)%2 == 0 ? qmc::beta : qmc::alpha;
-                        s.spin[ket] = s.spin[bra];
-                        
-                        if(init[bra] == 0) {
-                            if(qmc::n_bonds == qmc::hex) {
-                                s.bond[bra] = qmc::hori;
-                                s.bond[ket] = qmc::hori;
-                            }
-                            else {
-                                s.bond[bra] = (state%2==0 ? qmc::right:qmc::left);
-                                s.bond[ket] = (state%2==0 ? qmc::right:qmc::left);
-                            }
-                        }
-                        else if(init[bra] == 1) {
-                            s.bond[bra] = (state/L_%2==0 ? qmc::down:qmc::up);
-                            s.bond[ket] = (state/L_%2==0 ? qmc::down:qmc::up);
-                        }
-                        else if(init[bra] == 2) {
-                            if(qmc::n_bonds == qmc::hex) {
-                                s.bond[bra] = (state/L_%3==0 ? qmc::down: (state/L_%3==2 ? qmc::hori : qmc::up));
-                                s.bond[ket] = (state/L_%3==0 ? qmc::down: (state/L_%3==2 ? qmc::hori : qmc::up));
-                            }
-                            else if(qmc::n_bonds == qmc::tri) {
-                                s.bond[bra] = (state/L_%2==0 ? qmc::diag_down:qmc::diag_up);
-                                s.bond[ket] = (state/L_%2==0 ? qmc::diag_down:qmc::diag_up);
-                            }
-                        }
-                        s.loop[bra] = 1-(state + state / L_)%2; //important for tile_init hex
-                    ++state;
-                    }
-                );
-            }
+            init_spin_bond(init);
             //initialising the neighbor structure
             for(unsigned i = 0; i < H_; ++i) {
                 for(unsigned j = 0; j < L_; ++j) {
@@ -444,6 +730,48 @@ namespace perimeter_rvb {
                 }
             }
         }
+        ///  \brief sets the initial spins and bonds, one pass over the grid for all bras
+        ///  
+        ///  @param init is a vector that is as long as n_bra that specifies the initialisation
+        void init_spin_bond(std::vector<unsigned> const & init) {
+            site_type * const first = begin();
+            std::for_each(begin(), end(), 
+                [&](site_type & s) {
+                    index_type const idx = &s - first;
+                    for(state_type bra = qmc::start_state; bra < qmc::n_bra; ++bra) {
+                        state_type ket = qmc::invert_state - bra;
+                        s.spin[bra] = (idx + idx / L_)%2 == 0 ? qmc::beta : qmc::alpha;
+                        s.spin[ket] = s.spin[bra];
+                        
+                        if(init[bra] == 0) {
+                            if(qmc::n_bonds == qmc::hex) {
+                                s.bond[bra] = qmc::hori;
+                                s.bond[ket] = qmc::hori;
+                            }
+                            else {
+                                s.bond[bra] = (idx%2==0 ? qmc::right:qmc::left);
+                                s.bond[ket] = (idx%2==0 ? qmc::right:qmc::left);
+                            }
+                        }
+                        else if(init[bra] == 1) {
+                            s.bond[bra] = (idx/L_%2==0 ? qmc::down:qmc::up);
+                            s.bond[ket] = (idx/L_%2==0 ? qmc::down:qmc::up);
+                        }
+                        else if(init[bra] == 2) {
+                            if(qmc::n_bonds == qmc::hex) {
+                                s.bond[bra] = (idx/L_%3==0 ? qmc::down: (idx/L_%3==2 ? qmc::hori : qmc::up));
+                                s.bond[ket] = (idx/L_%3==0 ? qmc::down: (idx/L_%3==2 ? qmc::hori : qmc::up));
+                            }
+                            else if(qmc::n_bonds == qmc::tri) {
+                                s.bond[bra] = (idx/L_%2==0 ? qmc::diag_down:qmc::diag_up);
+                                s.bond[ket] = (idx/L_%2==0 ? qmc::diag_down:qmc::diag_up);
+                            }
+                        }
+                        s.loop[bra] = 1-(idx + idx / L_)%2; //important for tile_init hex
+                    }
+                }
+            );
+        }
         ///  \brief initializes the tile(s) for each site
         ///  
         ///  just calls set_info for all tiles
@@ -457,6 +785,105 @@ namespace perimeter_rvb {
                 );
             }
         }
+        ///  \brief updates all tiles in state that read the bonds of the sites in trace
+        ///
+        ///  used after a nonlocal bond update, since the tiles only keep themselves up to date in tile_update
+        void refresh_tiles(state_type const & state, std::vector<std::pair<site_type *, bond_type>> const & trace) {
+            std::for_each(trace.begin(), trace.end(),
+                [&](std::pair<site_type *, bond_type> const & p) {
+                    site_type * const s = p.first;
+                    for(bond_type b1 = qmc::me; b1 < qmc::n_bonds; ++b1) {
+                        site_type * const n1 = s->neighbor[b1];
+                        for(bond_type b2 = qmc::me; b2 < (tile_type::reach > 1 ? qmc::n_bonds : qmc::start_bond); ++b2)
+                            for(unsigned t = 0; t < tile_type::tile_per_site; ++t)
+                                n1->neighbor[b2]->tile[state][t].refresh();
+                    }
+                }
+            );
+        }
+        ///  \brief true if exactly one of a and b is in the selected swap region
+        static bool crosses(site_type const * a, site_type const * b) {
+            return (a->shift_region[qmc::ket_swap] != 0) != (b->shift_region[qmc::ket_swap] != 0);
+        }
+        ///  \brief keeps crossing2_ up to date, see no_observer_struct
+        struct crossing_observer_struct {
+            crossing_observer_struct(std::vector<int> & crossing2): crossing2(crossing2) {
+            }
+            void operator()(state_type const & state, site_type const * a, site_type const * b, int const & w) {
+                if(crosses(a, b))
+                    crossing2[state] += w;
+            }
+            std::vector<int> & crossing2;
+        };
+        ///  \brief keeps wind2_ up to date, see no_observer_struct and winding
+        struct winding_observer_struct {
+            winding_observer_struct(grid_class & grid): first(grid.begin()), H(grid.H_), L(grid.L_), wind2(grid.wind2_) {
+            }
+            void operator()(state_type const & state, site_type const * a, site_type const * b, int const & w) {
+                index_type const ia = (a - first) / L;
+                index_type const ja = (a - first) % L;
+                index_type const ib = (b - first) / L;
+                index_type const jb = (b - first) % L;
+                if((ja == L - 1 and jb == 0) or (jb == L - 1 and ja == 0)) //through the boundary in j
+                    wind2[2 * state] += w * (ja == L - 1 ? sublattice(ia, ja) : sublattice(ib, jb));
+                if((ia == H - 1 and ib == 0) or (ib == H - 1 and ia == 0)) //through the boundary in i
+                    wind2[2 * state + 1] += w * (ia == H - 1 ? sublattice(ia, ja) : sublattice(ib, jb));
+            }
+            ///  \brief +1 and -1 on the two sublattices of the bipartite grids, always +1 on tri
+            static int sublattice(index_type const & i, index_type const & j) {
+                return qmc::n_bonds == qmc::tri or (i + j) % 2 == 0 ? 1 : -1;
+            }
+            site_type const * const first;
+            index_type const H;
+            index_type const L;
+            std::vector<int> & wind2;
+        };
+        ///  \brief the observer of the bond updates, keeps crossing2_ and wind2_ up to date
+        struct bond_observer_struct {
+            bond_observer_struct(grid_class & grid): crossing(grid.crossing2_), winding(grid) {
+            }
+            void operator()(state_type const & state, site_type const * a, site_type const * b, int const & w) {
+                crossing(state, a, b, w);
+                winding(state, a, b, w);
+            }
+            crossing_observer_struct crossing;
+            winding_observer_struct winding;
+        };
+        ///  \brief true if the closed path of loop_bond_update_intern left all bonds of state as they were
+        ///  
+        ///  undoing the trace in reverse order gives the old bonds, they are compared to the new ones and the new
+        ///  ones are written again if they differ
+        bool unchanged(state_type const & state, std::vector<std::pair<site_type *, bond_type>> const & trace) {
+            static thread_local std::vector<bond_type> now; //per thread, the states are updated in parallel
+            now.clear();
+            for(auto const & t: trace)
+                now.push_back(t.first->bond[state]);
+            for(auto it = trace.rbegin(); it != trace.rend(); ++it)
+                it->first->bond[state] = it->second;
+            bool same = true;
+            for(unsigned k = 0; k < trace.size(); ++k)
+                same = same and trace[k].first->bond[state] == now[k];
+            if(not same)
+                for(unsigned k = 0; k < trace.size(); ++k)
+                    trace[k].first->bond[state] = now[k];
+            return same;
+        }
+        ///  \brief adds the bonds of a successful loop_bond_update in state to crossing2_ and wind2_
+        ///  
+        ///  trace holds the tail with its old bond and then head and next with their old bonds for every step. All
+        ///  bonds of next are removed, except at the last step where next is the tail, whose bond is already gone
+        void count_bonds(state_type const & state, std::vector<std::pair<site_type *, bond_type>> const & trace) {
+            bond_observer_struct obs(*this);
+            site_type * const tail = trace[0].first;
+            obs(state, tail, tail->neighbor[trace[0].second], -2);
+            for(unsigned k = 1; k + 1 < trace.size(); k += 2) {
+                site_type * const head = trace[k].first;
+                site_type * const next = trace[k + 1].first;
+                obs(state, head, next, +2);
+                if(next != tail)
+                    obs(state, next, next->neighbor[trace[k + 1].second], -2);
+            }
+        }
         ///  \brief during the loop update the next site in the loop is returned by this fct
         ///  
         ///  @param in is the entering site for which the neighbor is searched
@@ -478,6 +905,19 @@ namespace perimeter_rvb {
         loop_type n_neg_loops_; ///< amount of "negative" loops in the transition graph
         int sign_;              ///< sign of complete config (-1 is n_neg_loops_ is odd / +1 else)
         shift_type shift_mode_; ///< the current shift mode (no swap, preswap, swap)
+        std::vector<std::vector<shift_type>> swap_region_; ///< all swap regions, one of them is in the sites
+        std::vector<int> crossing2_; ///< twice the amount of bonds per state that cross the border of the swap region
+        std::vector<int> wind2_;     ///< twice the winding numbers, wind2_[2 * state + dir] (see winding)
+        
+        ///  \brief scratch memory of dimer_structure_factor, a grid is only measured by one thread at a time
+        struct dimer_workspace_struct {
+            std::vector<std::vector<double>> field;     ///< n_d of every state and direction (plus one empty if odd)
+            std::vector<std::complex<double>> fa;
+            std::vector<std::complex<double>> fb;
+            addon::fft_2d_class::workspace_struct fft;
+        };
+        addon::fft_2d_class dimer_fft_;             ///< plan of the H x L transform
+        mutable dimer_workspace_struct dimer_ws_;   ///< see dimer_structure_factor
     };
 }//end namespace perimeter_rvb
 #endif //__GRID_CLASS_HEADER
@@ -11,8 +11,157 @@
 #include <algorithm>
 #include <numeric>
 #include <cmath>
+#include <limits>
+#include <string>
+#include <stdint.h>
+
+#include <accum_log.hpp>
 
 namespace perimeter_rvb {
+    ///  \brief streaming jackknife over records of n_obs values
+    ///  
+    ///  The records are summed into at most max_blocks blocks. If all blocks are full, neighboring blocks are
+    ///  merged and the block size doubles, so the memory does not grow with the run. The estimate can be
+    ///  asked for at any time. Only the last block may be partially filled.
+    ///  
+    ///  Observables marked as log hold log2 values of the samples (see accumulator_log). They are summed
+    ///  with log-sum-exp and fct gets the log2 of their means, so overlaps of large systems never overflow.
+    class jackknife_class {
+        ///  \brief sum and count of the records in one block
+        struct block_struct {
+            block_struct(unsigned const & n_obs = 0): count(0), sum(n_obs, 0) {
+            }
+            template<typename Archive>
+            void serialize(Archive & ar) {
+                ar & count;
+                ar & sum;
+            }
+            uint64_t count;
+            std::vector<double> sum;
+        };
+    public:
+        jackknife_class(unsigned const & n_obs, unsigned const & max_blocks = 256): n_obs_(n_obs)
+                                                                                  , max_blocks_(max_blocks)
+                                                                                  , log_(n_obs, false)
+                                                                                  , block_size_(1) {
+        }
+        ///  \brief log[o] says if observable o is given as log2
+        jackknife_class(std::vector<bool> const & log, unsigned const & max_blocks = 256): n_obs_(log.size())
+                                                                                         , max_blocks_(max_blocks)
+                                                                                         , log_(log)
+                                                                                         , block_size_(1) {
+        }
+        ///  \brief adds one record (n_obs values)
+        void add(double const * record) {
+            if(block_.empty() or block_.back().count == block_size_) {
+                if(block_.size() == max_blocks_) {
+                    for(unsigned k = 0; k < max_blocks_ / 2; ++k) {
+                        block_[k] = block_[2 * k];
+                        add_block(block_[k], block_[2 * k + 1]);
+                    }
+                    block_.resize(max_blocks_ / 2);
+                    block_size_ *= 2;
+                }
+                if(block_.empty() or block_.back().count == block_size_)
+                    block_.push_back(empty_block());
+            }
+            ++block_.back().count;
+            for(unsigned o = 0; o < n_obs_; ++o)
+                add_to(block_.back().sum[o], record[o], o);
+        }
+        void add(std::vector<double> const & record) {
+            add(record.data());
+        }
+        ///  \brief amount of records
+        uint64_t count() const {
+            uint64_t n = 0;
+            for(unsigned k = 0; k < block_.size(); ++k)
+                n += block_[k].count;
+            return n;
+        }
+        ///  \brief jackknife mean and error of fct(means), where means are the leave-one-block-out means of all n_obs
+        ///  
+        ///  for log observables, means holds the log2 of the mean. With a single block there is nothing to leave
+        ///  out, the result is fct of the plain means with error 0.
+        ///  
+        ///  The sums without block k are the sums over the blocks before and after it. Subtracting block k from
+        ///  the total instead would cancel to log2(0) if the block holds almost all of the total, which happens
+        ///  for the overlaps of large systems
+        template<typename F>
+        std::pair<double, double> operator()(F fct) const {
+            std::vector<double> fjack;
+            std::vector<double> means(n_obs_);
+            if(block_.size() == 1) {
+                set_means(means, block_[0]);
+                return std::make_pair(fct(means), 0.0);
+            }
+            std::vector<block_struct> after(block_.size() + 1, empty_block()); //after[k]: blocks k, k + 1, ...
+            for(unsigned k = block_.size(); k-- > 0; ) {
+                after[k] = after[k + 1];
+                add_block(after[k], block_[k]);
+            }
+            block_struct before = empty_block();
+            for(unsigned k = 0; k < block_.size(); ++k) {
+                block_struct rest = after[k + 1];
+                add_block(rest, before);
+                set_means(means, rest);
+                fjack.push_back(fct(means));
+                add_block(before, block_[k]);
+            }
+            double N_1 = fjack.size() - 1;
+            double mean = accumulate(fjack.begin(), fjack.end(), 0.0) / fjack.size();
+            double sq_sum = std::inner_product(fjack.begin(), fjack.end(), fjack.begin(), 0.0);
+            double stmdev = std::sqrt(N_1 * std::max(0.0, sq_sum / fjack.size() - mean * mean));
+            return std::make_pair(mean, stmdev);
+        }
+        ///  \brief jackknife of -log(mean) of observable obs (the renyi entropy from an overlap)
+        std::pair<double, double> entropy(unsigned const & obs) const {
+            if(log_[obs])
+                return (*this)([&](std::vector<double> const & means) {return -means[obs] * std::log(2.0);});
+            return (*this)([&](std::vector<double> const & means) {return -std::log(means[obs]);});
+        }
+        template<typename Archive>
+        void serialize(Archive & ar) {
+            ar & block_size_;
+            ar & block_;
+        }
+    private:
+        ///  \brief block without records (the log sums start at log2(0))
+        block_struct empty_block() const {
+            block_struct b(n_obs_);
+            for(unsigned o = 0; o < n_obs_; ++o)
+                if(log_[o])
+                    b.sum[o] = -std::numeric_limits<double>::infinity();
+            return b;
+        }
+        ///  \brief sum += x, or the same in log2 for log observables
+        void add_to(double & sum, double const & x, unsigned const & o) const {
+            if(log_[o])
+                sum = accumulator_log::log2_add(sum, x);
+            else
+                sum += x;
+        }
+        ///  \brief adds the records of from to to
+        void add_block(block_struct & to, block_struct const & from) const {
+            to.count += from.count;
+            for(unsigned o = 0; o < n_obs_; ++o)
+                add_to(to.sum[o], from.sum[o], o);
+        }
+        ///  \brief the means of the records in b, log2 of the mean for log observables
+        void set_means(std::vector<double> & means, block_struct const & b) const {
+            for(unsigned o = 0; o < n_obs_; ++o)
+                means[o] = log_[o] ? b.sum[o] - std::log2(b.count) : b.sum[o] / b.count;
+        }
+    private:
+        unsigned n_obs_;
+        unsigned max_blocks_;           ///< even amount of blocks after which two blocks get merged
+        std::vector<bool> log_;         ///< says which observables are given as log2
+        uint64_t block_size_;           ///< records per full block
+        std::vector<block_struct> block_;
+    };
+    ///  \brief jackknife of -log(mean) over the bins in a text file (one value per line)
+    ///  
+    ///  only used for old runs that wrote a mean.txt instead of a bin file
     std::pair<double, double> jackknife(std::string name) {
         std::vector<double> data;
         std::vector<double> fjack;
@@ -196,9 +196,20 @@ def read_state_files(path, dirs):
 def collect_results(path, dirs):
     bash("cp addon/header.txt " + path + "/colres.txt")
     #~ fct = lambda path_dir: bash("tail -2 " + path_dir + "/fixres.txt >> " + path + "/colres.txt")
-    fct = lambda path_dir: bash("tail -2 " + path_dir + "/results.txt >> " + path + "/colres.txt")
+    fct = lambda path_dir: append_last_rows(path_dir + "/results.txt", path + "/colres.txt")
     
     recursion(path, dirs, fct)
+#a run writes one row per region followed by a "-----date" line, this appends the rows and the line of the last run
+def append_last_rows(res, dest):
+    lines = open(res, "r").read().splitlines()
+    end = len(lines)
+    start = end - 1
+    while start > 0 and not lines[start - 1].startswith("---") and not lines[start - 1].startswith("Time"):
+        start -= 1
+    ofs = open(dest, "a")
+    for line in lines[start:end]:
+        ofs.write(line + "\n")
+    ofs.close()
 #------------------- delete files ------------------- 
 def delete_files(path, dirs, files):
     
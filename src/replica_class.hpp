@@ -0,0 +1,270 @@
+// Author:  Mario S. Könz <mskoenz@gmx.net>
+// Date:    19.10.2026 17:21:40 EDT
+// File:    replica_class.hpp
+
+#ifndef __REPLICA_CLASS_HEADER
+#define __REPLICA_CLASS_HEADER
+
+#include <sim_class.hpp>
+#include <shift_region_class.hpp>
+#include <jackknife.hpp>
+
+#include <accum_log.hpp>
+#include <timer2_msk.hpp>
+#include <random2_msk.hpp>
+#include <immortal_msk.hpp>
+#include <thread_pool_msk.hpp>
+
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <cmath>
+
+//perimeter is documented in grid_class.hpp
+namespace perimeter_rvb {
+    ///  \brief the increment trick with replica exchange between neighbouring regions
+    ///
+    ///  The shift file holds the regions A_0, A_1, ..., A_N. Link k samples with A_k as preswap region and
+    ///  measures the increment S2(A_k+1) - S2(A_k), like in chain_class. There is one replica (sim_class) per link,
+    ///  all replicas run in parallel on param["threads"] threads. After every sweep, the configurations C_r
+    ///  and C_r+1 of neighbouring links are exchanged with the Metropolis probability
+    ///
+    ///      min(1, 2^(L_r+1(C_r) + L_r(C_r+1) - L_r(C_r) - L_r+1(C_r+1)))
+    ///
+    ///  where L_k(C) is the amount of loops of C with A_k as preswap region (pairs with even and odd r alternate).
+    ///  Instead of copying the grids, the replicas exchange their region and draw new spins for the new loops.
+    ///  Exchanges correlate the links, so the cumulative S2 is jackknifed from records that hold all links.
+    ///  After the thermalization a checkpoint of all replicas is written like in sim_class::run (addon::immortal).
+    class replica_class {
+        typedef addon::bash_parameter_class::map_type map_type; ///< just forwarding from bash_parameter
+
+        ///  \brief region k of a shift file as preswap region, and all regions of the file as swap regions
+        struct replica_region_struct {
+            replica_region_struct(shift_region_class const & full, unsigned const & k): full(full), k(k) {
+            }
+            unsigned size() const {
+                return full.size() + 1;
+            }
+            unsigned operator()(unsigned const & n, unsigned const & i, unsigned const & j) const {
+                return n == 0 ? full(k, i, j) : full(n - 1, i, j);
+            }
+            shift_region_class const & full;
+            unsigned const k;
+        };
+    public:
+        ///  \brief the only constructor
+        ///
+        ///  @param param is a map that contains the bash parameters, see sim_class
+        replica_class(map_type const & param):  param_(param)
+                                              , region_(std::string(param_["shift"]))
+                                              , pool_(std::min(unsigned(param_["threads"]), region_.size() - 1))
+                                              , link_(region_.size() - 1)
+                                              , loops_(link_.size())
+                                              , up_loops_(link_.size())
+                                              , down_loops_(link_.size())
+                                              , tried_(link_.size(), 0)
+                                              , accepted_(link_.size(), 0)
+                                              , bin_(link_.size())
+                                              , jack_(std::vector<bool>(link_.size(), true))
+                                              , therm_used_(0) {
+            map_type replica_param = param_;
+            replica_param["threads"] = 1;
+
+            for(unsigned k = 0; k < link_.size(); ++k) {
+                replica_.push_back(std::unique_ptr<sim_class>(new sim_class(replica_param, replica_region_struct(region_, k))));
+                link_[k] = k;
+            }
+        }
+        ///  \brief thermalizes and measures with exchanges, writes one results row per link with the cumulative S2
+        ///  
+        ///  -therm_auto, the checkpoints (param["checkpoint_seconds"], -del) and their defaults are the same as in
+        ///  sim_class, a checkpoint is also written at the end
+        void run() {
+            unsigned const n = link_.size();
+            uint64_t const sim = param_["sim"];
+
+            addon::timer_class<addon::data> timer(n, param_["res"]);
+            timer.set_names("seed"
+                          , "H"
+                          , "L"
+                          , "therm"
+                          , "sim"
+                          , "x"
+                          , "link"
+                          , "increment"
+                          , "increment_error"
+                          , "entropy"
+                          , "error"
+                          , "exchange"
+                          );
+
+            if(param_.find("del") != param_.end())
+                addon::immortal.reset();
+            addon::immortal.set_signature(signature());
+            if(addon::immortal.available()) {
+                std::cout << GREENB << "load data at index " << addon::immortal.get_index() << NONE << std::endl;
+                addon::immortal >> (*this);
+                for(unsigned r = 0; r < n; ++r) //the grids are stored without their preswap region
+                    replica_[r]->set_preswap_region(link_[r]);
+            }
+            else
+                thermalize();
+
+            auto const checkpoint_interval = sim_class::checkpoint_interval(param_);
+            auto next_checkpoint = std::chrono::steady_clock::now() + checkpoint_interval;
+            for(uint64_t i = addon::immortal.get_index(0); i < sim; ++i) {
+                sweep(therm_used_ + i, true);
+                bool const bin_end = (i & ((1lu<<10) - 1)) == ((1lu<<10) - 1); //same bins as sim_class::run
+                if(bin_end)
+                    close_bin();
+                if(i + 1 == sim or (bin_end and std::chrono::steady_clock::now() >= next_checkpoint)) {
+                    addon::immortal << (*this);
+                    addon::immortal.write_next_index(i + 1);
+                    next_checkpoint = std::chrono::steady_clock::now() + checkpoint_interval;
+                }
+            }
+
+            for(unsigned k = 0; k < n; ++k) {
+                std::pair<double, double> inc = jack_.entropy(k);
+                std::pair<double, double> cum = jack_(
+                    [&](std::vector<double> const & means) {
+                        double res = 0;
+                        for(unsigned l = 0; l <= k; ++l)
+                            res -= means[l] * std::log(2.0);
+                        return res;
+                    }
+                );
+                timer.write(addon::global_seed.get()
+                            , param_["H"]
+                            , param_["L"]
+                            , therm_used_
+                            , sim
+                            , param_["g"]
+                            , k
+                            , inc.first
+                            , inc.second
+                            , cum.first
+                            , cum.second
+                            , tried_[k] == 0 ? 0 : double(accepted_[k]) / tried_[k]
+                            );
+            }
+        }
+        ///  \brief describes what a checkpoint of the replicas holds (see immortal_class::set_signature)
+        std::string signature() const {
+            return "replica of " + std::to_string(link_.size()) + " links, " + replica_[0]->signature();
+        }
+        ///  \brief for the checkpoints, all replicas followed by the exchange state
+        template<typename Archive>
+        void serialize(Archive & ar) {
+            for(unsigned r = 0; r < replica_.size(); ++r)
+                ar & (*replica_[r]);
+            ar & link_;
+            ar & tried_;
+            ar & accepted_;
+            ar & bin_;
+            ar & jack_;
+            ar & rng_;
+            ar & therm_used_;
+        }
+    private:
+        ///  \brief thermalizes with exchanges and sets therm_used_ to the amount of sweeps done
+        ///  
+        ///  does param_["term"] sweeps, or fewer if -therm_auto is given and therm_class decides that the loops
+        ///  of every link (the amounts of loops with A_k and A_k+1 of the configuration at link k) are equilibrated
+        void thermalize() {
+            unsigned const n = link_.size();
+            uint64_t const term = param_["term"];
+            bool const adaptive = param_.find("therm_auto") != param_.end();
+            unsigned const every = sim_class::therm_every(param_);
+            therm_class therm = sim_class::therm_detector(param_, 2 * n);
+            std::vector<double> sample(2 * n);
+            
+            for(therm_used_ = 0; therm_used_ < term; ) {
+                sweep(therm_used_, false);
+                ++therm_used_;
+                if(adaptive and therm_used_ % every == 0) {
+                    for(unsigned k = 0; k < n; ++k) {
+                        sample[2 * k] = loops_[k];
+                        sample[2 * k + 1] = up_loops_[k];
+                    }
+                    if(therm.add(sample))
+                        break;
+                }
+            }
+            if(adaptive)
+                std::cout << "thermalized after " << therm_used_ << " sweeps (window " << therm.window() * every
+                          << " sweeps, tau " << therm.tau() * every << " sweeps)" << std::endl;
+        }
+        ///  \brief one sweep of all replicas followed by the exchanges of the pairs (k, k+1) with k % 2 == i % 2
+        void sweep(uint64_t const & i, bool const & measure) {
+            unsigned const n = link_.size();
+            unsigned const parity = i & 1;
+
+            //the replica of link k needs L_k, L_k+1 and for the upper replica of a pair also L_k-1
+            pool_.run(n,
+                [&](unsigned const & r) {
+                    sim_class & rep = *replica_[r];
+                    unsigned const & k = link_[r];
+                    rep.update();
+                    loops_[k] = rep.loops();
+                    up_loops_[k] = rep.loops_in(k + 1);
+                    if(k > 0 and (k - 1) % 2 == parity)
+                        down_loops_[k] = rep.loops_in(k - 1);
+                }
+            );
+
+            if(measure)
+                for(unsigned k = 0; k < n; ++k)
+                    bin_[k] << double(up_loops_[k]) - double(loops_[k]);
+
+            std::vector<unsigned> owner(n);
+            for(unsigned r = 0; r < n; ++r)
+                owner[link_[r]] = r;
+
+            std::vector<bool> moved(n, false);
+            for(unsigned k = parity; k + 1 < n; k += 2) {
+                double const exponent = double(up_loops_[k]) + double(down_loops_[k + 1])
+                                      - double(loops_[k]) - double(loops_[k + 1]);
+                ++tried_[k];
+                if(exponent >= 0 or rng_() < std::exp2(exponent)) {
+                    ++accepted_[k];
+                    std::swap(link_[owner[k]], link_[owner[k + 1]]);
+                    moved[owner[k]] = true;
+                    moved[owner[k + 1]] = true;
+                }
+            }
+
+            pool_.run(n,
+                [&](unsigned const & r) {
+                    if(moved[r])
+                        replica_[r]->set_preswap_region(link_[r]);
+                }
+            );
+        }
+        ///  \brief hands the log2 means of the finished bin to the jackknife
+        void close_bin() {
+            std::vector<double> record(bin_.size());
+            for(unsigned k = 0; k < bin_.size(); ++k) {
+                record[k] = bin_[k].log_mean();
+                bin_[k] = accumulator_log();
+            }
+            jack_.add(record);
+        }
+    private:
+        map_type param_;                ///< the parameter with all the settings
+        shift_region_class region_;     ///< A_0 to A_N
+        addon::thread_pool_class pool_; ///< runs the replicas in parallel
+        std::vector<std::unique_ptr<sim_class>> replica_; ///< the configurations
+        std::vector<unsigned> link_;    ///< replica r currently samples link link_[r]
+        std::vector<unsigned> loops_;       ///< L_k of the configuration at link k
+        std::vector<unsigned> up_loops_;    ///< L_k+1 of the configuration at link k
+        std::vector<unsigned> down_loops_;  ///< L_k-1 of the configuration at link k
+        std::vector<uint64_t> tried_;       ///< exchange attempts between link k and k+1
+        std::vector<uint64_t> accepted_;    ///< accepted exchanges between link k and k+1
+        std::vector<accumulator_log> bin_;  ///< the swap_overlap of every link in the current bin
+        jackknife_class jack_;              ///< one record per bin with the log2 swap_overlap of all links
+        addon::random_class<double, addon::mersenne> rng_; ///< exchange-random source
+        uint64_t therm_used_;               ///< amount of thermalization sweeps that were done
+    };
+}//end namespace perimeter_rvb
+#endif //__REPLICA_CLASS_HEADER
@@ -34,6 +34,9 @@ namespace perimeter_rvb {
         ///  1 0
         ///  
         ///  (again no space in this empty line!)
+        ///  
+        ///  The first block is the preswap region, every further block is a swap region. With more than one
+        ///  swap region all of them are measured against the same configuration
         shift_region_class(std::string filename) {
             std::ifstream in(filename);
             std::string temp;
@@ -62,6 +65,8 @@ namespace perimeter_rvb {
                 };
                 if(stage1_.back().size() == 0)
                     stage1_.pop_back();
+                if(stage1_.size() < 2)
+                    throw std::runtime_error("shift_region_class needs a preswap and at least one swap region");
                 H_ = stage1_[0].size();
                 L_ = consistent;
                 N_ = stage1_.size();
@@ -103,6 +108,10 @@ namespace perimeter_rvb {
                 }
             }
         }
+        ///  \brief number of regions (preswap + swap regions)
+        unsigned size() const {
+            return N_;
+        }
         ///  \brief return matrix-elements with this operator
         unsigned operator()(unsigned const & n, unsigned const & i, unsigned const & j) const {
             return stage2_[n][i][j];
@@ -131,7 +140,7 @@ namespace perimeter_rvb {
     private:
         unsigned H_;    ///< height
         unsigned L_;    ///< length
-        unsigned N_;    ///< number of shift regions (preswap/swap)
+        unsigned N_;    ///< number of shift regions (preswap + swap regions)
         std::vector<std::vector<std::string>> stage1_;  ///< the information that came from the file
         std::vector<std::vector<std::vector<unsigned>>> stage2_; ///< the parsed matrix
     };
@@ -5,19 +5,33 @@
 #ifndef __SIM_CLASS_HEADER
 #define __SIM_CLASS_HEADER
 
+#include <bin_store.hpp>
 #include <jackknife.hpp>
 #include <grid_class.hpp>
+#include <therm_class.hpp>
 #include <shift_region_class.hpp>
+#include <snapshot_stream.hpp>
 
 #include <timer2_msk.hpp>
 #include <random2_msk.hpp>
-#include <accum_double.hpp>
 #include <accum_simple.hpp>
+#include <accum_binning.hpp>
+#include <accum_log.hpp>
+#include <accum_double.hpp>
+#include <accum_histogram.hpp>
+#include <accum_registry.hpp>
 #include <immortal_msk.hpp>
+#include <thread_pool_msk.hpp>
+#include <fft_msk.hpp>
+#include <snapshot_ring_msk.hpp>
 #include <bash_parameter3_msk.hpp>
 
 #include <map>
 #include <cmath>
+#include <limits>
+#include <chrono>
+#include <memory>
+#include <sstream>
 #include <iostream>
 #include <assert.h>
 #include <algorithm>
@@ -29,23 +43,130 @@ namespace perimeter_rvb {
         typedef typename grid_class::index_type index_type; ///< just forwarding from grid
         typedef typename grid_class::site_type site_type; ///< just forwarding from grid
         typedef addon::bash_parameter_class::map_type map_type; ///< just forwarding from bash_parameter
+        typedef accum_registry<accumulator_binning> data_type; ///< flat storage of all observables
+        typedef accum_registry<accumulator_log> log_data_type; ///< flat storage of the observables that are only known as log2
+        typedef typename data_type::handle_type obs_type; ///< handle of an observable in data_ or log_data_
+        
+        ///  \brief everything a state needs for its bond updates
+        ///  
+        ///  each state has its own rng streams and acceptance counter, s.t. the bond updates of
+        ///  different states don't share anything and can run on different threads
+        struct layer_struct {
+            layer_struct(unsigned const & H, unsigned const & L): rngT(), rngH(H), rngL(L) {
+            }
+            template<typename Archive>
+            void serialize(Archive & ar) {
+                ar & rngT;
+                ar & rngH;
+                ar & rngL;
+                ar & accept;
+                ar & loop_accept;
+                ar & loop_length;
+            }
+            addon::random_class<double, addon::mersenne> rngT; ///< tile/loop-random source
+            addon::random_class<int, addon::mersenne> rngH;    ///< H-random source
+            addon::random_class<int, addon::mersenne> rngL;    ///< L-random source
+            accumulator_simple accept; ///< measures the update acceptance for bond_updates in this state
+            accumulator_simple loop_accept; ///< measures the acceptance of the loop_bond_updates in this state
+            accumulator_simple loop_length; ///< measures the amount of bonds written per loop_bond_update
+            std::vector<std::pair<site_type *, bond_type>> trace; ///< undo buffer for the loop_bond_update
+        };
     public:
-        ///  \brief the only constructor
+        ///  \brief the usual constructor, the shift regions are read from the file param["shift"]
+        ///  
+        ///  see the constructor below for the parameters
+        sim_class(map_type const & param): sim_class(param, shift_region_class(shift_file(param))) {
+        }
+        ///  \brief constructor with given shift regions
         ///  
         ///  @param param is a map that contains the bash parameters
+        ///  @param region holds the preswap and the swap regions (see grid_class::set_shift_region)
         ///  
         ///  param is used to specify all modifiable behavior of the simulation during runtime
-        sim_class(map_type const & param):    param_(param)
+        ///  
+        ///  if param["threads"] is larger than 1, the bond updates of the different states run
+        ///  on that many threads (at most n_states are used)
+        ///  
+        ///  param["loop_ratio"] is the average amount of loop_bond_updates per state and sweep (default 0)
+        ///  and param["loop_max"] the amount of steps after which one is rejected (default 10*H*L)
+        ///  
+        ///  -mutual reads the swap regions of the shift file as triples (A, B, AB) and writes their mutual
+        ///  information to param["mutual_res"] at the end of run
+        ///  
+        ///  with param["measure_workers"] > 0 run only publishes snapshots after each update and that many threads
+        ///  measure them in the background. param["measure_slots"] (default 2*measure_workers) snapshots can be in
+        ///  flight, if all are taken the measurement of the sweep is skipped instead of waiting
+        ///  
+        ///  with param["target_error"] and/or param["target_rel_error"] the run stops as soon as the jackknife error
+        ///  of S2 is small enough, param["sim"] is then only the maximum (see target_reached). It is checked every
+        ///  16*1024 sweeps and at every checkpoint, so a restart from a checkpoint that reached it stops right away
+        ///  
+        ///  every schedule task (loops and each swap region) is measured every param["interval_<name>"] sweeps
+        ///  (interval_loops, interval_swap, interval_swap_2, ..., interval_swap is the default of all swap regions).
+        ///  With -interval_auto the intervals are chosen from the autocorrelation times and costs. The cost of every task is printed
+        ///  at the end of run
+        ///  
+        ///  -corr measures <S_i.S_j> for all distances with the improved estimator of the loops (task "corr" of the
+        ///  schedule) and writes them to param["corr_res"] and the structure factor to param["sf_res"] at the end of
+        ///  run. S(pi, pi) is also in the observable structure_factor
+        ///  
+        ///  the winding numbers of every state are measured with the loops (observables winding_j_<state> and
+        ///  winding_i_<state>), run prints how often the sector of every state changed
+        ///  
+        ///  -dimer measures the structure factor of the dimer field of every bond direction with an fft (task "dimer"
+        ///  of the schedule) and writes it to param["dimer_sf_res"] and the dimer correlations to param["dimer_corr_res"]
+        ///  at the end of run (per process). The mean over the directions at (pi, pi) is the observable dimer_sf, so
+        ///  H and L have to be even
+        ///  
+        ///  -snapshots appends every param["snap_every"]-th (default 1) configuration of the simulation to the binary
+        ///  stream param["snap_res"] (see snapshot_writer_class). A background thread writes them, if it lags behind
+        ///  configurations are dropped instead of slowing down the simulation
+        ///  
+        ///  a checkpoint is written every param["checkpoint_seconds"] (default 300) of wall time, when the target is
+        ///  reached, at the end of the run and never during the thermalization. It replaces the state file atomically
+        ///  (see immortal_class), running a finished simulation again only writes its results again. A restart
+        ///  truncates the bins and the snapshot stream to the checkpoint. A checkpoint of another lattice, size or
+        ///  build isn't loaded, run throws instead
+        ///  
+        ///  -async_checkpoint copies the checkpoint to memory and writes the files on a background thread while the
+        ///  simulation continues (see immortal_class::write_async)
+        ///  
+        ///  -loop_hist records the loop lengths of the measured sweeps in preswap mode and of the first swap region
+        ///  and writes their distribution to param["loop_hist_res"] at the end of run
+        ///  
+        ///  if -therm_auto is given, the thermalization stops as soon as therm_class is satisfied with loops and
+        ///  swap_loops, but after param["term"] sweeps at the latest. Only every param["therm_every"]-th (default 8)
+        ///  sweep is given to therm_class, since swap_loops costs about as much as a sweep. param["therm_window"]
+        ///  (default 1024), param["therm_tol"] (default 2) and param["therm_tau"] (default 20) are forwarded to
+        ///  therm_class and count these samples, not sweeps
+        template<typename R>
+        sim_class(map_type const & param, R const & region):    param_(param)
                                             , H_(param_["H"])
                                             , L_(param_["L"])
                                             , grid_(H_, L_, std::vector<unsigned>(2, qmc::n_bonds == qmc::hex ? 2 : 0))
+                                            , loop_ratio_(param_["loop_ratio"])
+                                            , loop_max_(param_.find("loop_max") != param_.end() ? unsigned(param_["loop_max"]) : 10 * H_ * L_)
+                                            , therm_used_(0)
+                                            , loop_hist_(param_.find("loop_hist") != param_.end())
                                             , rngS_()
-                                            , rngH_(H_)
-                                            , rngL_(L_)
+                                            #ifdef SIMUVIZ_FRAMES
+                                            , pool_(1) //the frames are written in the bond update
+                                            #else
+                                            , pool_(std::min(unsigned(param_["threads"]), unsigned(qmc::n_states)))
+                                            #endif //SIMUVIZ_FRAMES
                                             {
-                                                
-            shift_region_class sr_(param_["shift"]);
-            grid_.set_shift_region(sr_);
+            for(state_type state = qmc::start_state; state < qmc::n_states; ++state) {
+                layer_.push_back(layer_struct(H_, L_));
+                obs_winding_.push_back(data_.add("winding_j_" + std::to_string(state)));
+                obs_winding_.push_back(data_.add("winding_i_" + std::to_string(state)));
+            }
+            
+            grid_.set_shift_region(region);
+            init_regions();
+            if(param_.find("mutual") != param_.end() and grid_.n_swap_regions() % 3 != 0)
+                throw std::runtime_error("-mutual needs the swap regions as triples A, B, AB in the shift file");
+            if(param_.find("dimer") != param_.end() and (H_ % 2 != 0 or L_ % 2 != 0))
+                throw std::runtime_error("-dimer needs even H and L, (pi, pi) is no momentum of the grid otherwise");
             
             //uncomment for negative "vortex" init in the triangular case (fails for sqr and hex)
             //~ state_type state = 0;
@@ -74,10 +195,16 @@ namespace perimeter_rvb {
             grid_.clear_tile_spin();
             grid_.copy_to_ket();
         }
+        ///  \brief the name of the shift file in param
+        static std::string shift_file(map_type const & param) {
+            return param.at("shift");
+        }
         ///  \brief just forwards the two bond update to the grid with a random tile (tri only)
+        ///  
+        ///  the tile is chosen with the rng of the state, so this is safe to call in parallel for different states
         bool two_bond_update(index_type i, index_type j, state_type state) {
             if(qmc::n_bonds == qmc::tri)
-                return grid_.two_bond_update_intern(i, j, state, int(rngS_() * 3));
+                return grid_.two_bond_update_intern(i, j, state, int(layer_[state].rngT() * 3));
             else
                 return grid_.two_bond_update_intern(i, j, state, 0);
         }
@@ -92,11 +219,82 @@ namespace perimeter_rvb {
             else
                 return grid_.two_bond_update_intern(i, j, state, 0);
         }
+        ///  \brief nonlocal bond update that starts at a random site of state
+        ///  
+        ///  uses only the rngs of the state, so this is safe to call in parallel for different states.
+        ///  Returns true if the update was accepted
+        bool loop_bond_update(state_type const & state) {
+            layer_struct & layer = layer_[state];
+            unsigned length = grid_.loop_bond_update_intern(layer.rngH(), layer.rngL(), state, layer.rngT, loop_max_, layer.trace);
+            layer.loop_accept << (length != 0);
+            layer.loop_length << length;
+            return length != 0;
+        }
+        ///  \brief amount of loops in the swap zone
+        ///  
+        ///  the preswap loops are already known after update, since spin_update needs them
+        unsigned swap_loops() {
+            grid_.set_shift_mode(qmc::ket_swap);
+            grid_.init_loops();
+            unsigned n = grid_.n_loops();
+            grid_.set_shift_mode(qmc::ket_preswap);
+            return n;
+        }
+        ///  \brief amount of loops in the preswap zone after update
+        unsigned loops() const {
+            return grid_.n_loops();
+        }
+        ///  \brief amount of loops if swap region k was the swap zone (selects it in the grid)
+        unsigned loops_in(unsigned const & k) {
+            grid_.select_swap_region(k);
+            return swap_loops();
+        }
+        ///  \brief uses swap region k as the preswap region from now on
+        ///  
+        ///  the sampled ensemble changes with the preswap region, so the spins are drawn again for the new loops
+        void set_preswap_region(unsigned const & k) {
+            grid_.select_preswap_region(k);
+            respin();
+        }
+        ///  \brief draws new spins for all preswap loops
+        ///  
+        ///  unlike spin_update this doesn't need spins that are consistent with the loops: every loop gets a
+        ///  random start spin and the spins alternate along the loop
+        void respin() {
+            grid_.set_shift_mode(qmc::ket_preswap);
+            grid_.init_loops();
+            
+            for(state_type bra = qmc::start_state; bra < qmc::n_bra; ++bra) {
+                grid_.alternator_ = bra;
+                std::for_each(grid_.begin(), grid_.end(), 
+                    [&](site_type & s) {
+                        if(s.check[bra] == false) {
+                            spin_type spin = rngS_() > .5 ? qmc::alpha : qmc::beta;
+                            grid_.follow_loop_tpl(&s, bra, 
+                                [&](site_type * next) {
+                                    next->check[bra] = true;
+                                    next->spin[bra] = spin;
+                                    spin = qmc::invert_spin - spin;
+                                }
+                            );
+                        }
+                    }
+                );
+            }
+            grid_.clear_check();
+            grid_.copy_to_ket(); //bc spins have changed
+            grid_.clear_tile_spin(); //bc spins have changed
+        }
         ///  \brief changes the spin of the loops
         ///  
         ///  Decides at random (50:50) for every loop if all spins in the loop should be flipped or not
         void spin_update() {
-            grid_.init_loops();
+            if(loop_hist_) { //the lengths of this sweep, they go to preswap_hist_ if the sweep is measured
+                sweep_hist_ = accumulator_histogram();
+                grid_.init_loops([&](loop_type const & length, state_type const & bra) {sweep_hist_ << length;});
+            }
+            else
+                grid_.init_loops();
             
             for(state_type bra = qmc::start_state; bra < qmc::n_bra; ++bra) {
                 grid_.alternator_ = bra;
@@ -130,64 +328,628 @@ namespace perimeter_rvb {
         }
         ///  \brief updates bonds and spins
         ///  
-        ///  does H*L update atempts on random tiles for each state followed by a spin_update
+        ///  does H*L update atempts on random tiles for each state followed by loop_ratio_ loop_bond_updates
+        ///  (on average) and a spin_update. The bond updates only touch bond[state] and tile[state], so the
+        ///  states are distributed over the threads of pool_. The spin_update works on whole loops and stays serial
         void update() {
             grid_.set_shift_mode(qmc::no_shift);
             
-            for(state_type state = qmc::start_state; state < qmc::n_states; ++state)
-                for(unsigned i = 0; i < H_ * L_; ++i) {
-                    bool ok = two_bond_update(rngH_(), rngL_(), state);
-                    accept_ << ok;
-                    #ifdef SIMUVIZ_FRAMES
-                        if(ok)
-                            simuviz_frame();
-                    #endif //SIMUVIZ_FRAMES
+            pool_.run(qmc::n_states, 
+                [&](unsigned const & state) {
+                    layer_struct & layer = layer_[state];
+                    for(unsigned i = 0; i < H_ * L_; ++i) {
+                        bool ok = two_bond_update(layer.rngH(), layer.rngL(), state);
+                        layer.accept << ok;
+                        #ifdef SIMUVIZ_FRAMES
+                            if(ok)
+                                simuviz_frame();
+                        #endif //SIMUVIZ_FRAMES
+                    }
+                    unsigned const n_loop = loop_ratio_ + layer.rngT(); //loop_ratio_ on average
+                    for(unsigned i = 0; i < n_loop; ++i)
+                        loop_bond_update(state);
                 }
+            );
             
             grid_.set_shift_mode(qmc::ket_preswap);
             spin_update();
             grid_.copy_to_ket(); //bc spins have changed
             grid_.clear_tile_spin(); //bc spins have changed
         }
+        ///  \brief name of an observable of swap region k
+        ///  
+        ///  the first region keeps the plain name, the others get the number of their block in the shift file
+        static std::string region_name(std::string const & name, unsigned const & k) {
+            return k == 0 ? name : name + "_" + std::to_string(k + 1);
+        }
+        ///  \brief declares the observables of all swap regions and sets up the bins
+        void init_regions() {
+            unsigned const n = grid_.n_swap_regions();
+            for(unsigned k = 0; k < n; ++k) {
+                obs_sign_.push_back(data_.add(region_name("sign", k)));
+                obs_neg_loops_.push_back(data_.add(region_name("neg_loops", k)));
+                obs_swap_loops_.push_back(data_.add(region_name("swap_loops", k)));
+                obs_swap_exponent_.push_back(data_.add(region_name("swap_exponent", k)));
+                obs_swap_overlap_.push_back(log_data_.add(region_name("swap_overlap", k)));
+            }
+            bin_overlap_ = std::vector<accumulator_log>(n);
+            bin_obs_ = std::vector<obs_type>(1, obs_loops_);
+            bin_obs_.insert(bin_obs_.end(), obs_swap_loops_.begin(), obs_swap_loops_.end());
+            bin_sum_ = std::vector<double>(bin_obs_.size(), 0);
+            bin_count_ = std::vector<uint64_t>(bin_obs_.size(), 0);
+            jack_ = jackknife_class(log_names(bin_names()));
+            
+            schedule_.clear();
+            schedule_.push_back(schedule_struct("loops", obs_loops_, interval("loops")));
+            for(unsigned k = 0; k < n; ++k)
+                schedule_.push_back(schedule_struct(region_name("swap", k), obs_swap_exponent_[k], interval(region_name("swap", k))));
+            option_.loop_hist = loop_hist_;
+            option_.corr = 0;
+            option_.dimer = 0;
+            if(param_.find("corr") != param_.end()) {
+                obs_structure_factor_ = data_.add("structure_factor");
+                corr_ = std::vector<accumulator_binning>(H_ * L_);
+                option_.corr = schedule_.size();
+                schedule_.push_back(schedule_struct("corr", obs_structure_factor_, interval("corr")));
+            }
+            if(param_.find("dimer") != param_.end()) {
+                obs_dimer_sf_ = data_.add("dimer_sf");
+                dimer_sf_ = std::vector<accumulator_double>(grid_class::n_dimer_dirs * H_ * L_);
+                option_.dimer = schedule_.size();
+                schedule_.push_back(schedule_struct("dimer", obs_dimer_sf_, interval("dimer")));
+            }
+        }
+        ///  \brief measurement interval of a schedule task from param_["interval_<name>"] (default 1)
+        ///  
+        ///  the swap regions fall back to param_["interval_swap"]. The interval is at most max_interval
+        unsigned interval(std::string const & name) {
+            unsigned res = 1;
+            if(param_.find("interval_" + name) != param_.end())
+                res = param_["interval_" + name];
+            else if(name.compare(0, 4, "swap") == 0 and param_.find("interval_swap") != param_.end())
+                res = param_["interval_swap"];
+            return std::max(1u, std::min(res, unsigned(max_interval)));
+        }
         ///  \brief measures wanted properties
         ///  
-        ///  just add your own data_["your_tag"] << your_value; to measure something
+        ///  just declare your own obs_type const obs_your_tag_ = data_.add("your_tag"); next to data_,
+        ///  add the raw value to sample_struct in compute and data_[obs_your_tag_] << your_value; to record
+        ///  
+        ///  all swap regions are measured against the same bonds and spins. Outside of measure the
+        ///  first swap region is selected in the grid
         void measure() {
+            sample_struct sample = compute(grid_, std::vector<bool>(schedule_.size(), true), option_);
+            sample.preswap_hist = sweep_hist_;
+            record(sample);
+        }
+        ///  \brief measures the tasks of schedule_ that are due in sweep i, see due
+        void measure(uint64_t const & i) {
+            std::vector<bool> const d = due(i);
+            if(std::find(d.begin(), d.end(), true) != d.end()) {
+                sample_struct sample = compute(grid_, d, option_);
+                sample.preswap_hist = sweep_hist_;
+                record(sample);
+            }
+        }
+        ///  \brief one measurement task (a group of observables) with its interval and cost
+        struct schedule_struct {
+            schedule_struct(std::string const & name, obs_type const & obs, unsigned const & interval): name(name)
+                                                                                                      , obs(obs)
+                                                                                                      , interval(interval)
+                                                                                                      , samples(0)
+                                                                                                      , seconds(0)
+                                                                                                      , adapted(false) {
+            }
+            ///  \brief only the interval and if it was adapted, samples and seconds are per process
+            template<typename Archive>
+            void serialize(Archive & ar) {
+                ar & interval;
+                ar & adapted;
+            }
+            std::string name;
+            obs_type obs;       ///< the observable in data_ whose tau sets the interval with -interval_auto
+            unsigned interval;  ///< the task is measured every interval sweeps
+            uint64_t samples;   ///< measurements in this process
+            double seconds;     ///< wall time of compute in this process
+            bool adapted;       ///< true after adapt_intervals chose the interval
+        };
+        static unsigned const bin_sweeps = 1024;  ///< sweeps per bin without skipped measurements (see bin_ready)
+        static unsigned const max_interval = 256; ///< s.t. every bin of bin_sweeps sweeps has samples of every task
+        
+        ///  \brief says for every task of schedule_ if it is measured in sweep i
+        std::vector<bool> due(uint64_t const & i) const {
+            std::vector<bool> res;
+            for(unsigned t = 0; t < schedule_.size(); ++t)
+                res.push_back(i % schedule_[t].interval == 0);
+            return res;
+        }
+        ///  \brief chooses the interval of every task from its autocorrelation time and cost (-interval_auto)
+        ///  
+        ///  with tau in sweeps, a cost c per sample and a cost u per sweep of the update, measuring every n sweeps
+        ///  needs a time ~ (u + c/n)(n + 2tau) for a given error, which is smallest for n = sqrt(2 tau c / u).
+        ///  Every task is adapted once, as soon as it has enough binning levels for tau. After that the
+        ///  samples would mix intervals and the tau in sweeps couldn't be read off the accumulator anymore
+        void adapt_intervals(double const & update_cost) {
+            for(unsigned t = 0; t < schedule_.size(); ++t) {
+                schedule_struct & task = schedule_[t];
+                accumulator_binning const & acc = data_[task.obs];
+                if(task.adapted or acc.levels() < 3 or task.samples == 0)
+                    continue;
+                double const tau_sweeps = (acc.tau() + .5) * task.interval - .5;
+                double const n = std::sqrt(2 * std::max(tau_sweeps, 0.0) * task.seconds / task.samples / update_cost);
+                task.interval = std::max(1u, std::min(unsigned(n + .5), unsigned(max_interval)));
+                task.adapted = true;
+            }
+        }
+        ///  \brief writes interval, samples and wall time of every task
+        void print_schedule(double const & update_seconds, uint64_t const & sweeps) const {
+            std::cout << "update: " << update_seconds << " s  (" << (sweeps ? update_seconds / sweeps * 1e6 : 0) << " us/sweep)" << std::endl;
+            for(unsigned t = 0; t < schedule_.size(); ++t) {
+                schedule_struct const & task = schedule_[t];
+                std::cout << task.name << ": every " << task.interval << " sweeps, " << task.samples << " samples, "
+                          << task.seconds << " s  (" << (task.samples ? task.seconds / task.samples * 1e6 : 0) << " us/sample)" << std::endl;
+            }
+        }
+        ///  \brief prints the last winding sector of every state and how often it changed between measurements
+        ///  
+        ///  the tile updates alone can't leave a sector. With loop updates (see loop_ratio) a state that never
+        ///  changes its sector is marked as stuck
+        void print_winding() const {
+            for(state_type state = qmc::start_state; state < qmc::n_states; ++state) {
+                bool const stuck = loop_ratio_ > 0 and sector_changes_[state] == 0;
+                std::cout << "winding of state " << state << ": (" << last_winding_[2 * state] << ", " << last_winding_[2 * state + 1]
+                          << "), " << sector_changes_[state] << " changes" << (stuck ? " (stuck)" : "") << std::endl;
+            }
+        }
+        ///  \brief the raw values of one measurement, see compute and record
+        ///  
+        ///  only the tasks in due were measured, the swap values of the other regions are not set
+        struct sample_struct {
+            std::vector<bool> due;              ///< per schedule task, 0 is loops, 1 + k swap region k
+            std::vector<double> seconds;        ///< wall time of compute per schedule task
+            loop_type loops;                    ///< preswap loops (always set, they are needed for the swap)
+            double crossing;                    ///< bonds across the border of the first swap region, mean over the states
+            std::vector<int> winding;           ///< winding numbers, 2 * state + dir (see grid_class::winding)
+            std::vector<int> sign;              ///< sign of the swap config, per swap region
+            std::vector<loop_type> neg_loops;   ///< per swap region
+            std::vector<loop_type> swap_loops;  ///< per swap region
+            std::vector<double> corr;           ///< <S_i.S_i+d> for every distance d (only with -corr)
+            std::vector<double> dimer_sf;       ///< dimer structure factor of every direction and momentum (only with -dimer)
+            accumulator_histogram preswap_hist; ///< loop lengths in preswap mode (only with -loop_hist)
+            accumulator_histogram swap_hist;    ///< loop lengths of the first swap region (only with -loop_hist)
+        };
+        ///  \brief what compute measures besides the loops and the swap regions, the same for the whole run
+        struct option_struct {
+            bool loop_hist;     ///< fill swap_hist with the loop lengths of the first swap region
+            unsigned corr;      ///< schedule task of the spin correlations, 0 if there is none
+            unsigned dimer;     ///< schedule task of the dimer structure factor, 0 if there is none
+        };
+        ///  \brief a configuration and the tasks that should be measured on it
+        struct snapshot_struct {
+            grid_class::snapshot_struct config;
+            std::vector<bool> due;
+        };
+        ///  \brief snapshots go to background workers that return samples
+        typedef addon::snapshot_ring_class<snapshot_struct, sample_struct> measure_ring_type;
+        ///  \brief the expensive part of measure, only needs the grid
+        ///  
+        ///  the preswap loops of grid must be initialized. Doesn't touch the simulation, s.t. it can run on
+        ///  another grid that holds a snapshot (see -measure_workers in run)
+        ///  
+        ///  @param due says which schedule tasks are measured (0 is loops, 1 + k swap region k, then the optional ones)
+        ///  @param option says where the optional tasks are
+        static sample_struct compute(grid_class & grid, std::vector<bool> const & due, option_struct const & option) {
+            typedef std::chrono::steady_clock clock_type;
+            unsigned const n = grid.n_swap_regions();
+            sample_struct res;
+            res.due = due;
+            res.seconds = std::vector<double>(due.size(), 0);
+            res.sign = std::vector<int>(n, 0);
+            res.neg_loops = std::vector<loop_type>(n, 0);
+            res.swap_loops = std::vector<loop_type>(n, 0);
             //=================== preswap zone ===================
-            double loops = grid_.n_loops();
-            
-            data_["loops"] << loops;
-            data_["overlap"] << pow(2.0, loops - 2*H_*L_* .5 );
+            res.loops = grid.n_loops();
+            res.crossing = grid.crossing(); //the first swap region is selected here, O(1)
+            for(state_type state = qmc::start_state; state < qmc::n_states; ++state)
+                for(unsigned dir = 0; dir < 2; ++dir)
+                    res.winding.push_back(grid.winding(state, dir)); //O(1)
+            if(option.corr != 0 and due[option.corr]) { //needs the preswap loop labels, so before the swap zone
+                clock_type::time_point const start = clock_type::now();
+                grid.spin_correlation(res.corr);
+                res.seconds[option.corr] = std::chrono::duration<double>(clock_type::now() - start).count();
+            }
+            if(option.dimer != 0 and due[option.dimer]) {
+                clock_type::time_point const start = clock_type::now();
+                grid.dimer_structure_factor(res.dimer_sf);
+                res.seconds[option.dimer] = std::chrono::duration<double>(clock_type::now() - start).count();
+            }
             //=================== swap zone ===================
-            grid_.set_shift_mode(qmc::ket_swap);
-            grid_.init_loops();
-            //grid_.eco_init_loops(); one could do a more efficient init_loop
-            
-            data_["sign"] << (grid_.sign() == 1);
-            data_["neg_loops"] << grid_.n_neg_loops() / (double)grid_.n_loops();
-            data_["swap_loops"] << grid_.n_loops();
-            data_["swap_overlap"] << pow(2.0, int(grid_.n_loops()) - loops);
-            data_["mean_for_error"] << pow(2.0, int(grid_.n_loops()) - loops);
+            unsigned selected = 0;
+            for(unsigned k = 0; k < n; ++k) {
+                if(not due[1 + k])
+                    continue;
+                clock_type::time_point const start = clock_type::now();
+                if(k != selected)
+                    grid.select_swap_region(k);
+                selected = k;
+                grid.set_shift_mode(qmc::ket_swap);
+                if(option.loop_hist and k == 0)
+                    grid.init_loops([&](loop_type const & length, state_type const & bra) {res.swap_hist << length;});
+                else
+                    grid.init_loops();
+                //grid.eco_init_loops(); one could do a more efficient init_loop
+                
+                res.sign[k] = grid.sign();
+                res.neg_loops[k] = grid.n_neg_loops();
+                res.swap_loops[k] = grid.n_loops();
+                res.seconds[1 + k] = std::chrono::duration<double>(clock_type::now() - start).count();
+            }
+            if(selected != 0)
+                grid.select_swap_region(0);
             
             //=================== back to preswap ===================
-            grid_.set_shift_mode(qmc::ket_preswap);
+            grid.set_shift_mode(qmc::ket_preswap);
+            return res;
         }
-        ///  \brief writes the the bins into the mean_file
+        ///  \brief the cheap part of measure, hands a sample to the accumulators and the cost to schedule_
+        void record(sample_struct const & sample) {
+            for(unsigned t = 0; t < schedule_.size(); ++t) {
+                schedule_[t].samples += sample.due[t];
+                schedule_[t].seconds += sample.seconds[t];
+            }
+            //=================== preswap zone ===================
+            double loops = sample.loops;
+            
+            if(sample.due[0]) {
+                preswap_hist_.merge(sample.preswap_hist);
+                data_[obs_loops_] << loops;
+                data_[obs_vb_crossing_] << sample.crossing;
+                for(unsigned w = 0; w < obs_winding_.size(); ++w) {
+                    data_[obs_winding_[w]] << sample.winding[w];
+                    if(data_[obs_winding_[w]].count() > 1 and sample.winding[w] != last_winding_[w])
+                        ++sector_changes_[w / 2];
+                }
+                last_winding_ = sample.winding;
+                log_data_[obs_overlap_] << loops - 2*H_*L_* .5; //2^(loops - N/2) in log2
+            }
+            //=================== swap zone ===================
+            for(unsigned k = 0; k < obs_swap_overlap_.size(); ++k) {
+                if(not sample.due[1 + k])
+                    continue;
+                double swap_loops = sample.swap_loops[k];
+                
+                data_[obs_sign_[k]] << (sample.sign[k] == 1);
+                data_[obs_neg_loops_[k]] << sample.neg_loops[k] / swap_loops;
+                data_[obs_swap_loops_[k]] << swap_loops;
+                log_data_[obs_swap_overlap_[k]] << swap_loops - loops; //2^(swap_loops - loops) in log2
+                data_[obs_swap_exponent_[k]] << swap_loops - loops;
+                bin_overlap_[k] << swap_loops - loops;
+                if(k == 0)
+                    swap_hist_.merge(sample.swap_hist);
+            }
+            //=================== spin correlations ===================
+            if(option_.corr != 0 and sample.due[option_.corr]) {
+                double structure_factor = 0; //S(pi, pi)
+                for(unsigned d = 0; d < corr_.size(); ++d) {
+                    corr_[d] << sample.corr[d];
+                    structure_factor += ((d / L_ + d % L_) % 2 ? -1 : 1) * sample.corr[d];
+                }
+                data_[obs_structure_factor_] << structure_factor;
+            }
+            //=================== dimers ===================
+            if(option_.dimer != 0 and sample.due[option_.dimer]) {
+                unsigned const q_pi = H_ / 2 * L_ + L_ / 2;
+                double dimer_sf = 0; //mean over the directions at (pi, pi)
+                for(unsigned q = 0; q < dimer_sf_.size(); ++q) {
+                    dimer_sf_[q] << sample.dimer_sf[q];
+                    if(q % (H_ * L_) == q_pi)
+                        dimer_sf += sample.dimer_sf[q] / grid_class::n_dimer_dirs;
+                }
+                data_[obs_dimer_sf_] << dimer_sf;
+            }
+        }
+        ///  \brief names of the observables in a bin record
         ///  
-        ///  @param bins is a vector with values that need to go into the mean_file
-        ///  @param mean_file is the file where the values are appended to
+        ///  the log2 of the swap_overlap of every region (they give the entropies) followed by the bin_obs_
+        std::vector<std::string> bin_names() const {
+            std::vector<std::string> names;
+            for(unsigned k = 0; k < obs_swap_overlap_.size(); ++k)
+                names.push_back("log2_" + log_data_.name(obs_swap_overlap_[k]));
+            for(unsigned o = 0; o < bin_obs_.size(); ++o)
+                names.push_back(data_.name(bin_obs_[o]));
+            return names;
+        }
+        ///  \brief says for each name if it is a log2 observable
+        static std::vector<bool> log_names(std::vector<std::string> const & names) {
+            std::vector<bool> log;
+            for(unsigned o = 0; o < names.size(); ++o)
+                log.push_back(names[o].compare(0, 5, "log2_") == 0);
+            return log;
+        }
+        ///  \brief samples of schedule task t in a bin, as many as bin_sweeps sweeps give at its interval
+        uint64_t bin_samples(unsigned const & t) const {
+            return (bin_sweeps + schedule_[t].interval - 1) / schedule_[t].interval;
+        }
+        ///  \brief true if every observable of a bin record has bin_samples since the last close_bin
         ///  
-        ///  since writing files is slow, we want to collect some values before writing. That why there's a vector
-        void write_bins(std::vector<double> & bins, std::string const & mean_file) {
-            std::ofstream ofs;
-            ofs.open(mean_file, std::ios::app);
-            std::for_each(bins.begin(), bins.end(), 
-                [&](double const & d) {
-                    ofs << d << std::endl;
+        ///  the bins are closed by samples and not by sweeps, s.t. all bins have the same weight in the jackknife,
+        ///  also if async measurements were skipped (back-pressure). bin_obs_ are the loops (task 0) and the
+        ///  swap_loops of every region (task 1 + k, as bin_overlap_)
+        bool bin_ready() {
+            for(unsigned k = 0; k < bin_overlap_.size(); ++k)
+                if(bin_overlap_[k].count() < bin_samples(1 + k))
+                    return false;
+            return data_[bin_obs_[0]].count() - bin_count_[0] >= bin_samples(0);
+        }
+        ///  \brief ends the current bin and returns its record
+        ///  
+        ///  the record holds the log2 of the mean swap_overlap of each region and the means of the bin_obs_ since the
+        ///  last call. It also goes to jack_, s.t. the jackknife is known at any time during the run
+        std::vector<double> close_bin() {
+            unsigned const n = bin_overlap_.size();
+            std::vector<double> record(n + bin_obs_.size());
+            for(unsigned k = 0; k < n; ++k) {
+                record[k] = bin_overlap_[k].log_mean();
+                bin_overlap_[k] = accumulator_log();
+            }
+            for(unsigned o = 0; o < bin_obs_.size(); ++o) {
+                accumulator_binning const & acc = data_[bin_obs_[o]];
+                record[n + o] = (acc.sum() - bin_sum_[o]) / (acc.count() - bin_count_[o]);
+                bin_sum_[o] = acc.sum();
+                bin_count_[o] = acc.count();
+            }
+            jack_.add(record);
+            return record;
+        }
+        ///  \brief streaming jackknife of the entropy of swap region k
+        std::pair<double, double> entropy(unsigned const & k = 0) const {
+            return jack_.entropy(k);
+        }
+        ///  \brief amount of thermalization sweeps that were done
+        unsigned therm_used() const {
+            return therm_used_;
+        }
+        ///  \brief describes what a checkpoint of this simulation holds (see immortal_class::set_signature)
+        ///
+        ///  a checkpoint is only loaded if the strings are equal byte for byte. The fields, separated by spaces:
+        ///  - layout n: version of the serialized layout of sim_class and everything it holds
+        ///  - grid g, S s, states n: GRID_TYPE, S_ORDER and qmc::n_states of the build
+        ///  - H h, L l: size of the lattice
+        ///  - regions r: amount of swap regions in the shift file (the observables depend on it)
+        ///  - bond b, spin s: bytes of bond_type and spin_type (the raw sections of grid_class)
+        ///  - corr, dimer: only if the option is on, they add observables and accumulators
+        ///  
+        ///  chain_class and replica_class put "chain/replica of n links, " in front
+        std::string signature() const {
+            unsigned const layout = 2; //bump whenever a serialize of sim_class, chain_class, replica_class or their members changes
+            std::stringstream res;
+            res << "layout " << layout << " grid " << GRID_TYPE << " S " << S_ORDER << " states " << qmc::n_states
+                << " H " << H_ << " L " << L_ << " regions " << grid_.n_swap_regions()
+                << " bond " << sizeof(bond_type) << " spin " << sizeof(spin_type);
+            if(option_.corr != 0) //declares an observable and adds corr_
+                res << " corr";
+            if(option_.dimer != 0)
+                res << " dimer";
+            return res.str();
+        }
+        ///  \brief every how many sweeps the thermalization detector gets a sample, param["therm_every"] (default 8)
+        static unsigned therm_every(map_type const & param) {
+            return param.find("therm_every") != param.end() ? std::max(1u, unsigned(param.at("therm_every"))) : 8;
+        }
+        ///  \brief the thermalization detector for n_obs observables with the settings of param (see the constructor)
+        static therm_class therm_detector(map_type const & param, unsigned const & n_obs) {
+            return therm_class(n_obs
+                             , param.find("therm_window") != param.end() ? unsigned(param.at("therm_window")) : 1024
+                             , param.find("therm_tol") != param.end() ? double(param.at("therm_tol")) : 2
+                             , param.find("therm_tau") != param.end() ? double(param.at("therm_tau")) : 20
+                             );
+        }
+        ///  \brief wall time between two checkpoints, param["checkpoint_seconds"] (default 300)
+        static std::chrono::steady_clock::duration checkpoint_interval(map_type const & param) {
+            double const seconds = param.find("checkpoint_seconds") != param.end() ? double(param.at("checkpoint_seconds")) : 300;
+            return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+        }
+        ///  \brief the jackknife of a finished run that is not in memory (-fix)
+        ///  
+        ///  reads the bin file and throws a runtime_error if there is none.
+        ///  Observables whose name starts with log2_ are given as log2
+        jackknife_class fix_jackknife(std::string const & bin_file) const {
+            bin_view_class view(bin_file);
+            jackknife_class jack(log_names(view.names()));
+            for(uint64_t i = 0; i < view.size(); ++i)
+                jack.add(view[i]);
+            return jack;
+        }
+        ///  \brief writes I(A:B) = S2(A) + S2(B) - S2(AB) for every triple of swap regions (A, B, AB)
+        ///  
+        ///  @param jack holds the log2 swap_overlap of all regions in the same records, so the jackknife
+        ///  takes the correlations between the three entropies into account
+        void write_mutual(jackknife_class const & jack) {
+            addon::timer_class<addon::data> timer(1, param_["mutual_res"]);
+            timer.set_names("seed"
+                          , "H"
+                          , "L"
+                          , "therm"
+                          , "sim"
+                          , "x"
+                          , "region"
+                          , "mutual"
+                          , "error"
+                          , "entropy_A"
+                          , "entropy_B"
+                          , "entropy_AB"
+                          );
+            for(unsigned t = 0; t + 2 < obs_swap_overlap_.size(); t += 3) {
+                auto mutual = jack(
+                    [&](std::vector<double> const & means) {
+                        return -(means[t] + means[t + 1] - means[t + 2]) * std::log(2.0);
+                    }
+                );
+                timer.write(addon::global_seed.get()
+                            , H_
+                            , L_
+                            , therm_used_
+                            , param_["sim"]
+                            , param_["g"]
+                            , t / 3
+                            , mutual.first
+                            , mutual.second
+                            , jack.entropy(t).first
+                            , jack.entropy(t + 1).first
+                            , jack.entropy(t + 2).first
+                            );
+            }
+        }
+        ///  \brief writes the spin correlations for every distance and the structure factor for every momentum
+        ///  
+        ///  Distances (dx, dy) and momenta q = 2pi (qx / H, qy / L) are in index coordinates, the structure
+        ///  factor S(q) = sum_d cos(q.d) <S_i.S_i+d> is built from the mean correlations (see structure_factor for an error)
+        void write_corr() {
+            addon::timer_class<addon::data> corr_timer(1, param_["corr_res"]);
+            corr_timer.set_names("seed"
+                               , "H"
+                               , "L"
+                               , "dx"
+                               , "dy"
+                               , "corr"
+                               , "error"
+                               );
+            for(unsigned d = 0; d < corr_.size(); ++d)
+                corr_timer.write(addon::global_seed.get()
+                                 , H_
+                                 , L_
+                                 , d / L_
+                                 , d % L_
+                                 , corr_[d].mean()
+                                 , corr_[d].error()
+                                 );
+            
+            addon::timer_class<addon::data> sf_timer(1, param_["sf_res"]);
+            sf_timer.set_names("seed"
+                             , "H"
+                             , "L"
+                             , "qx"
+                             , "qy"
+                             , "structure_factor"
+                             );
+            for(unsigned qx = 0; qx < H_; ++qx)
+                for(unsigned qy = 0; qy < L_; ++qy) {
+                    double sf = 0;
+                    for(unsigned d = 0; d < corr_.size(); ++d)
+                        sf += std::cos(2 * M_PI * (double(qx * (d / L_)) / H_ + double(qy * (d % L_)) / L_)) * corr_[d].mean();
+                    sf_timer.write(addon::global_seed.get()
+                                   , H_
+                                   , L_
+                                   , qx
+                                   , qy
+                                   , sf
+                                   );
                 }
-            );
-            ofs.close();
-            bins.clear();
+        }
+        ///  \brief writes the dimer structure factor of every direction and momentum and the dimer correlations
+        ///  
+        ///  the directions are the ones of grid_class::dimer_dir, momenta and distances are in index coordinates like in
+        ///  write_corr. The correlations <n_d(r) n_d(r + dr)> are the inverse fft of the mean structure factor. The errors
+        ///  of the structure factor ignore autocorrelations (see dimer_sf in the observables for a binned error)
+        void write_dimer() {
+            unsigned const N = H_ * L_;
+            addon::timer_class<addon::data> sf_timer(1, param_["dimer_sf_res"]);
+            sf_timer.set_names("seed"
+                             , "H"
+                             , "L"
+                             , "dir"
+                             , "qx"
+                             , "qy"
+                             , "structure_factor"
+                             , "error"
+                             );
+            addon::timer_class<addon::data> corr_timer(1, param_["dimer_corr_res"]);
+            corr_timer.set_names("seed"
+                               , "H"
+                               , "L"
+                               , "dir"
+                               , "dx"
+                               , "dy"
+                               , "corr"
+                               );
+            addon::fft_2d_class fft(H_, L_);
+            for(unsigned dir = 0; dir < grid_class::n_dimer_dirs; ++dir) {
+                std::vector<std::complex<double>> corr(N);
+                for(unsigned q = 0; q < N; ++q) {
+                    accumulator_double const & acc = dimer_sf_[dir * N + q];
+                    corr[q] = acc.mean();
+                    sf_timer.write(addon::global_seed.get()
+                                   , H_
+                                   , L_
+                                   , dir
+                                   , q / L_
+                                   , q % L_
+                                   , acc.mean()
+                                   , acc.error()
+                                   );
+                }
+                fft(corr, true);
+                for(unsigned d = 0; d < N; ++d)
+                    corr_timer.write(addon::global_seed.get()
+                                     , H_
+                                     , L_
+                                     , dir
+                                     , d / L_
+                                     , d % L_
+                                     , corr[d].real() / N
+                                     );
+            }
+        }
+        ///  \brief writes the distribution of the loop lengths, one row per non-empty bin
+        ///  
+        ///  mode 0 are the loops in preswap mode, mode 1 the ones of the first swap region. Small lengths have
+        ///  a bin each, large ones share log-spaced bins [loop_size_min, loop_size_max] (see accumulator_histogram)
+        void write_loop_hist() {
+            addon::timer_class<addon::data> timer(1, param_["loop_hist_res"]);
+            timer.set_names("seed"
+                          , "H"
+                          , "L"
+                          , "mode"
+                          , "loop_size_min"
+                          , "loop_size_max"
+                          , "loop_prob"
+                          , "count"
+                          );
+            accumulator_histogram const * hist[2] = {&preswap_hist_, &swap_hist_};
+            for(unsigned mode = 0; mode < 2; ++mode)
+                for(unsigned b = 0; b < hist[mode]->size(); ++b)
+                    if((*hist[mode])[b] != 0)
+                        timer.write(addon::global_seed.get()
+                                    , H_
+                                    , L_
+                                    , mode
+                                    , hist[mode]->lower(b)
+                                    , hist[mode]->upper(b)
+                                    , hist[mode]->prob(b)
+                                    , (*hist[mode])[b]
+                                    );
+        }
+        ///  \brief thermalizes and sets therm_used_ to the amount of sweeps done
+        ///  
+        ///  does param_["term"] sweeps, or fewer if -therm_auto is given and therm_class decides that
+        ///  loops and swap_loops are equilibrated. They are only sampled every param_["therm_every"]-th sweep
+        template<typename T>
+        void thermalize(T & timer) {
+            unsigned const term = param_["term"];
+            bool const adaptive = param_.find("therm_auto") != param_.end();
+            unsigned const every = therm_every(param_);
+            therm_class therm = therm_detector(param_, 2);
+            
+            for(therm_used_ = 0; therm_used_ < term; ) {
+                update();
+                timer.progress(therm_used_, param_["timer_dest"]);
+                ++therm_used_;
+                if(adaptive and therm_used_ % every == 0 and therm.add({double(grid_.n_loops()), double(swap_loops())}))
+                    break;
+            }
+            if(adaptive)
+                std::cout << "thermalized after " << therm_used_ << " sweeps (window " << therm.window() * every
+                          << " sweeps, tau " << therm.tau() * every << " sweeps)" << std::endl;
         }
         ///  \brief core of the simulation
         ///  
@@ -202,92 +964,260 @@ namespace perimeter_rvb {
                           , "H"
                           , "L"
                           //~ , "sign"
+                          , "therm"
                           , "sim"
                           , "x"
+                          , "region"
                           , "preswap_entropy"
                           , "neg_loops"
                           , "loop_time[us]"
                           , "entropy"
                           , "error"
-                          ); //can take maximally 10 arguments
+                          , "tau"
+                          , "vb_entropy"
+                          , "vb_error"
+                          );
             timer.set_comment("measurement"); //optional, only shows in print not write
             
-            //where the mean bins are
-            std::string mean_file = (std::string)param_["prog_dir"] + "/mean.txt";
+            //where the bins are
+            bin_store_class bins((std::string)param_["prog_dir"] + "/bins.bin", bin_names());
+            std::string mean_file = (std::string)param_["prog_dir"] + "/mean.txt"; //only for older runs
             
-            std::vector<double> bins;
+            //sweeps that were done (fewer than param_["sim"] if the target error was reached, see target_reached)
+            uint64_t sim_used = param_["sim"];
             
             //if -fix is found in the bash arguments it will just recalculate the jackknife
             if(param_.find("fix") == param_.end()) {
                 //if -del is found in the bash arguments all progress/mean files will be deleted
                 if(param_.find("del") != param_.end()) {
                     addon::immortal.reset();
+                    bins.remove();
                     remove(mean_file.c_str());
                     remove((std::string(param_["prog_dir"]) + "/state.txt").c_str()); //timer...
+                    if(param_.find("snapshots") != param_.end()) //the stream is appended to, also after a checkpoint
+                        remove(std::string(param_["snap_res"]).c_str());
                 }
+                addon::immortal.set_signature(signature()); //a checkpoint of another lattice, size or build is rejected by available
                 if(addon::immortal.available()) { //else if there are progress files around they get loaded
                     std::cout << GREENB << "load data at index " << addon::immortal.get_index() << NONE << std::endl;
                     addon::immortal >> (*this);
+                    bins.truncate(bin_records_); //the bins after the checkpoint are done again
                 }
                 else {//otherwise the thermalization begins normally
+                    bins.truncate(0); //flushed by a run that died before its first checkpoint was published
                     //------------------- therm -------------------
                     std::cout << std::endl;
-                    for(unsigned i = 0; i < param_["term"]; ++i) {
-                        update();
-                        timer.progress(i, param_["timer_dest"]);
+                    thermalize(timer);
+                }
+                //------------------- async measurement -------------------
+                //with -measure_workers n, n threads measure snapshots in the background (see measure_ring_type)
+                unsigned const n_workers = param_.find("measure_workers") != param_.end() ? unsigned(param_["measure_workers"]) : 0;
+                std::vector<std::unique_ptr<grid_class>> worker_grid;
+                std::unique_ptr<measure_ring_type> ring;
+                auto record_fct = [&](sample_struct const & sample) {record(sample);};
+                if(n_workers > 0) {
+                    for(unsigned w = 0; w < n_workers; ++w) {
+                        worker_grid.push_back(std::unique_ptr<grid_class>(new grid_class(H_, L_, std::vector<unsigned>(2, qmc::n_bonds == qmc::hex ? 2 : 0))));
+                        worker_grid.back()->copy_shift_region(grid_);
                     }
+                    ring.reset(new measure_ring_type(param_.find("measure_slots") != param_.end() ? unsigned(param_["measure_slots"]) : 2 * n_workers
+                                                   , n_workers
+                                                   , [&](snapshot_struct const & snap, unsigned const & w) {
+                                                        auto start = std::chrono::steady_clock::now();
+                                                        grid_class & grid = *worker_grid[w];
+                                                        grid.load_snapshot(snap.config);
+                                                        accumulator_histogram hist;
+                                                        if(loop_hist_)
+                                                            grid.init_loops([&](loop_type const & length, state_type const & bra) {hist << length;});
+                                                        else
+                                                            grid.init_loops();
+                                                        double const load = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                                                        sample_struct res = compute(grid, snap.due, option_);
+                                                        res.preswap_hist = hist;
+                                                        res.seconds[0] += load; //the preswap loops are not free here
+                                                        return res;
+                                                    }
+                                                   ));
+                }
+                //------------------- snapshot stream -------------------
+                //with -snapshots every param["snap_every"]-th configuration is appended to param["snap_res"] in the background
+                std::unique_ptr<snapshot_writer_class> writer;
+                uint64_t const snap_every = param_.find("snap_every") != param_.end() ? uint64_t(param_["snap_every"]) : 1;
+                if(param_.find("snapshots") != param_.end()) {
+                    writer.reset(new snapshot_writer_class(param_["snap_res"], H_, L_));
+                    writer->truncate(snap_bytes_); //like the bins, the frames after the checkpoint are done again
                 }
                 //------------------- sim -------------------
-                std::ofstream ofs;
-                for(unsigned i = addon::immortal.get_index(0); i < param_["sim"]; ++i) {
+                //every task of schedule_ is measured in its own interval (-interval_<name>, -interval_auto)
+                bool const interval_auto = param_.find("interval_auto") != param_.end();
+                bool const async_checkpoint = param_.find("async_checkpoint") != param_.end();
+                auto const checkpoint_interval = sim_class::checkpoint_interval(param_);
+                auto next_checkpoint = std::chrono::steady_clock::now() + checkpoint_interval;
+                uint64_t const first_sweep = addon::immortal.get_index(0);
+                uint64_t checkpoint_index = first_sweep; //index of the last checkpoint
+                double update_seconds = 0;
+                auto write_checkpoint = [&](uint64_t const & index, bool const & async) {
+                    //------------------- write out bins -------------------
+                    //before the checkpoint is published, a restart from the previous one truncates to its bin_records_
+                    bins.flush();
+                    bin_records_ = bins.size();
+                    if(writer) { //the stream holds all sweeps up to the checkpoint
+                        writer->flush();
+                        snap_bytes_ = writer->size();
+                    }
+                    //------------------- serialize config -------------------
+                    if(async) //only the copy to memory stalls the chain
+                        addon::immortal.write_async(*this, index);
+                    else {
+                        addon::immortal << (*this);
+                        addon::immortal.write_next_index(index);
+                    }
+                    checkpoint_index = index;
+                };
+                
+                //the target is checked at every checkpoint, so continuing from one that reached it ends the run
+                bool const done = first_sweep > 0 and target_reached();
+                if(done) {
+                    sim_used = first_sweep;
+                    std::cout << "target reached after " << sim_used << " sweeps: S2 = " << jack_.entropy(0).first
+                              << " +/- " << jack_.entropy(0).second << std::endl;
+                }
+                for(unsigned i = first_sweep; not done and i < param_["sim"]; ++i) {
                     
+                    auto start = std::chrono::steady_clock::now();
                     update();
-                    measure();
+                    update_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    if(ring) {
+                        std::vector<bool> const d = due(i);
+                        if(std::find(d.begin(), d.end(), true) != d.end())
+                            ring->publish([&](snapshot_struct & snap) {grid_.save_snapshot(snap.config); snap.due = d;});
+                        ring->collect(record_fct);
+                    }
+                    else
+                        measure(i);
+                    if(writer and i % snap_every == 0)
+                        writer->write(grid_, i);
                     timer.progress(param_["term"] + i, param_["timer_dest"]);
                     
-                    if((i & ((1lu<<10) - 1)) == ((1lu<<10) - 1)) { //all 1024 one mean gets added to the bins vector
-                        
-                        bins.push_back(data_["mean_for_error"].mean());
-                        data_["mean_for_error"] = accumulator_double();
-                        
-                        if((i & ((1lu<<14) - 1)) == ((1lu<<14) - 1)) { //all 16*1024 the progress is saved and the bins written
-                            //------------------- write out bins -------------------
-                            write_bins(bins, mean_file);
-                            //------------------- serialize config -------------------
-                            addon::immortal << (*this);
-                            addon::immortal.write_next_index(i + 1);
-                        }
+                    bool const check_target = (i & ((1lu<<14) - 1)) == ((1lu<<14) - 1); //all 16*1024 the target precision is checked
+                    bool const checkpoint = std::chrono::steady_clock::now() >= next_checkpoint;
+                    
+                    if(ring and (checkpoint or check_target or i + 1 == param_["sim"])) //the checkpoint and the last bin must hold all published samples
+                        ring->drain(record_fct);
+                    if(bin_ready()) { //a record gets added to the bins once it has the samples of bin_sweeps sweeps
+                        bins.push_back(close_bin());
+                        if(interval_auto) //between two bins, s.t. no bin mixes intervals
+                            adapt_intervals(update_seconds / (i + 1 - first_sweep));
                     }
+                    bool const target = (check_target or checkpoint) and target_reached(); //a checkpoint never skips the target
+                    if(checkpoint or target) { //the final state of a run that reached its target is saved as well
+                        write_checkpoint(i + 1, async_checkpoint);
+                        next_checkpoint = std::chrono::steady_clock::now() + checkpoint_interval;
+                    }
+                    //------------------- target precision -------------------
+                    if(target) {
+                        sim_used = i + 1;
+                        std::cout << "target reached after " << sim_used << " sweeps: S2 = " << jack_.entropy(0).first
+                                  << " +/- " << jack_.entropy(0).second << std::endl;
+                        break;
+                    }
+                }
+                if(ring) {
+                    ring->drain(record_fct);
+                    std::cout << "skipped measurements: " << ring->skipped() << std::endl;
                 }
-                write_bins(bins, mean_file);
+                if(writer) {
+                    writer->flush();
+                    std::cout << "dropped snapshots: " << writer->dropped() << std::endl;
+                }
+                //a finished run is saved as well, so running it again only writes the same results again
+                if(sim_used > checkpoint_index)
+                    write_checkpoint(sim_used, false);
+                addon::immortal.wait(); //the last checkpoint is complete before the results are written
+                print_schedule(update_seconds, sim_used - first_sweep);
+                print_winding();
+                bins.flush();
                 timer.write_state(param_["term"] + param_["sim"]);
             }
             
             
-            auto jack = jackknife(mean_file); //calc jackknife from mean_file
+            //the streaming jackknife is up to date, except for -fix where nothing is loaded
+            std::vector<std::pair<double, double>> jack;
+            jackknife_class full = jack_;
+            if(param_.find("fix") != param_.end()) {
+                try {
+                    full = fix_jackknife(bins.name());
+                } catch(std::runtime_error const & e) { //runs that are older than the bin file
+                    jack.push_back(jackknife(mean_file));
+                }
+            }
+            if(jack.empty())
+                for(unsigned k = 0; k < obs_swap_overlap_.size(); ++k)
+                    jack.push_back(full.entropy(k));
             
-            timer.write(addon::global_seed.get()
-                        , H_
-                        , L_
-                        //~ , data_["sign"].mean()
-                        , param_["sim"]
-                        , param_["g"]
-                        , -std::log(data_["swap_overlap"].mean())
-                        , data_["neg_loops"].mean()
-                        , timer.loop_time()
-                        , jack.first
-                        , jack.second
-                        ); //can take maximally 10 arguments
+            //one row per swap region
+            for(unsigned k = 0; k < jack.size(); ++k)
+                timer.write(addon::global_seed.get()
+                            , H_
+                            , L_
+                            //~ , data_[obs_sign_[k]].mean()
+                            , therm_used_
+                            , sim_used
+                            , param_["g"]
+                            , k
+                            , -log_data_[obs_swap_overlap_[k]].log_mean() * std::log(2.0)
+                            , data_[obs_neg_loops_[k]].mean()
+                            , timer.loop_time()
+                            , jack[k].first
+                            , jack[k].second
+                            , data_[obs_swap_exponent_[k]].tau()
+                            , k == 0 ? data_[obs_vb_crossing_].mean() * std::log(2.0) : std::numeric_limits<double>::quiet_NaN()
+                            , k == 0 ? data_[obs_vb_crossing_].error() * std::log(2.0) : std::numeric_limits<double>::quiet_NaN()
+                            );
+            
+            if(param_.find("mutual") != param_.end() and full.count() > 0)
+                write_mutual(full);
+            if(loop_hist_)
+                write_loop_hist();
+            if(not corr_.empty())
+                write_corr();
+            if(not dimer_sf_.empty())
+                write_dimer();
+        }
+        ///  \brief true if S2 of the first swap region is as precise as asked for
+        ///  
+        ///  the target is an absolute error param_["target_error"] and/or an error param_["target_rel_error"]
+        ///  relative to |S2|, one of them suffices. Without any target the run always does param_["sim"] sweeps
+        bool target_reached() {
+            bool const absolute = param_.find("target_error") != param_.end();
+            bool const relative = param_.find("target_rel_error") != param_.end();
+            if((not absolute and not relative) or jack_.count() < 2)
+                return false;
+            std::pair<double, double> const s2 = jack_.entropy(0);
+            return (absolute and s2.second <= double(param_["target_error"]))
+                or (relative and s2.second <= double(param_["target_rel_error"]) * std::abs(s2.first));
         }
         ///  \brief just printing the data in the accumulators
         void present_data() {
-            std::for_each(data_.begin(), data_.end(), 
-                [&](std::pair<std::string const, accumulator_double> & p) {
-                    std::cout << p.first << ": " << p.second << std::endl;
+            data_.for_each(
+                [&](std::string const & name, accumulator_binning const & acc) {
+                    std::cout << name << ": " << acc << "  tau: " << acc.tau() << (acc.converged() ? "" : " (not converged)") << std::endl;
+                }
+            );
+            log_data_.for_each(
+                [&](std::string const & name, accumulator_log const & acc) {
+                    std::cout << name << ": " << acc << std::endl;
                 }
             );
-            std::cout << "S2 = " << -std::log(data_["swap_overlap"].mean()) << std::endl;
-            std::cout << "accept " << int(accept_.mean() * 100) << "%" << std::endl;
+            for(unsigned k = 0; k < obs_swap_overlap_.size(); ++k)
+                std::cout << region_name("S2", k) << " = " << -log_data_[obs_swap_overlap_[k]].log_mean() * std::log(2.0) << std::endl;
+            for(state_type state = qmc::start_state; state < qmc::n_states; ++state) {
+                std::cout << "accept state " << state << ": " << int(layer_[state].accept.mean() * 100) << "%";
+                if(loop_ratio_ > 0)
+                    std::cout << "  loop accept: " << int(layer_[state].loop_accept.mean() * 100) << "%"
+                              << "  loop length: " << layer_[state].loop_length.mean();
+                std::cout << std::endl;
+            }
         }
         ///  \brief small helper for simuviz_frame
         int simuviz_get_bond(site_type const & s, bond_type const & dir, bool const & spin_up) {
@@ -364,23 +1294,82 @@ namespace perimeter_rvb {
         template<typename Archive>
         void serialize(Archive & ar) {
             ar & rngS_;
-            ar & rngH_;
-            ar & rngL_;
-            ar & accept_;
+            for(state_type state = qmc::start_state; state < qmc::n_states; ++state)
+                ar & layer_[state];
             ar & grid_;
             ar & data_;
+            ar & log_data_;
+            ar & therm_used_;
+            ar & bin_sum_;
+            ar & bin_count_;
+            ar & bin_records_;
+            ar & snap_bytes_;
+            ar & bin_overlap_;
+            ar & jack_;
+            for(unsigned t = 0; t < schedule_.size(); ++t) //with -interval_auto a restart keeps the adapted intervals
+                ar & schedule_[t];
+            ar & preswap_hist_;
+            ar & swap_hist_;
+            ar & corr_;
+            ar & dimer_sf_;
+            ar & last_winding_;
+            ar & sector_changes_;
         }
     private:
         map_type param_;    ///< the parameter with all the settings
         const unsigned H_;  ///< height
         const unsigned L_;  ///< length
         grid_class grid_;   ///< the actual grid
-        addon::random_class<double, addon::mersenne> rngS_; ///< spin/tile-random source
-        addon::random_class<int, addon::mersenne> rngH_;    ///< H-random source
-        addon::random_class<int, addon::mersenne> rngL_;    ///< L-random source
+        double const loop_ratio_;   ///< average amount of loop_bond_updates per state and sweep
+        unsigned const loop_max_;   ///< maximal amount of steps of a loop_bond_update
+        unsigned therm_used_;       ///< amount of thermalization sweeps that were done
+        bool const loop_hist_;      ///< if the loop lengths are recorded
+        addon::random_class<double, addon::mersenne> rngS_; ///< spin-random source
+        std::vector<layer_struct> layer_;   ///< rngs and acceptance for the bond updates of each state
+        addon::thread_pool_class pool_;     ///< runs the bond updates of the states in parallel
+        
+        data_type data_;    ///< all measurements are stored in here
+        //------------------- observables in data_, declare new ones here -------------------
+        obs_type const obs_loops_ = data_.add("loops");
+        obs_type const obs_vb_crossing_ = data_.add("vb_crossing"); ///< bonds across the border of the first swap region, per state
+        std::vector<obs_type> obs_winding_; ///< winding number of every state and direction, 2 * state + dir, declared in the constructor
+        //one per swap region, declared in init_regions
+        std::vector<obs_type> obs_sign_;
+        std::vector<obs_type> obs_neg_loops_;
+        std::vector<obs_type> obs_swap_loops_;
+        std::vector<obs_type> obs_swap_exponent_; ///< log2 of swap_overlap, for its tau
+        
+        log_data_type log_data_; ///< the overlaps, that over/underflow as doubles for large systems
+        obs_type const obs_overlap_ = log_data_.add("overlap");
+        std::vector<obs_type> obs_swap_overlap_; ///< one per swap region
+        
+        //------------------- bins (set up in init_regions) -------------------
+        std::vector<accumulator_log> bin_overlap_; ///< swap_overlap of each region in the current bin, the first values in a record (give the entropies)
+        std::vector<obs_type> bin_obs_;     ///< observables of data_ in a bin record
+        std::vector<double> bin_sum_;       ///< sums of the bin_obs_ at the end of the last bin
+        std::vector<uint64_t> bin_count_;   ///< counts of the bin_obs_ at the end of the last bin
+        uint64_t bin_records_ = 0;          ///< records in the bin file at the last checkpoint
+        uint64_t snap_bytes_ = 0;           ///< bytes in the snapshot stream at the last checkpoint (with -snapshots)
+        jackknife_class jack_ = jackknife_class(0); ///< streaming jackknife over all records
+        
+        //------------------- loop lengths (only with -loop_hist) -------------------
+        accumulator_histogram sweep_hist_;      ///< loop lengths of the last spin_update (not serialized)
+        accumulator_histogram preswap_hist_;    ///< loop lengths of the measured sweeps in preswap mode
+        accumulator_histogram swap_hist_;       ///< loop lengths of the measured sweeps in the first swap region
+        
+        //------------------- winding sectors -------------------
+        std::vector<int> last_winding_ = std::vector<int>(2 * qmc::n_states, 0); ///< winding numbers of the last measurement
+        std::vector<uint64_t> sector_changes_ = std::vector<uint64_t>(qmc::n_states, 0); ///< sector changes per state between measurements
+        
+        //------------------- spin correlations (only with -corr) -------------------
+        obs_type obs_structure_factor_;             ///< S(pi, pi) in data_, declared in init_regions
+        std::vector<accumulator_binning> corr_;     ///< <S_i.S_i+d> for every distance d = dx * L + dy
         
-        std::map<std::string, accumulator_double> data_;    ///< all measurements are stored in here
-        accumulator_simple accept_; ///< measures the update acceptance for bond_updates
+        //------------------- dimers (only with -dimer) -------------------
+        obs_type obs_dimer_sf_;                     ///< dimer structure factor at (pi, pi) in data_, declared in init_regions
+        std::vector<accumulator_double> dimer_sf_;  ///< for every direction and momentum, dir * H * L + qx * L + qy
+        option_struct option_;                      ///< the optional tasks for compute, set in init_regions
+        std::vector<schedule_struct> schedule_; ///< task 0 are the preswap loops, task 1 + k swap region k
     };
 }
 #endif //__SIM_CLASS_HEADER
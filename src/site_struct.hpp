@@ -161,6 +161,11 @@ namespace perimeter_rvb {
         bool tile_update(state_type const & state, unsigned const & t_nr) {
             return tile[state][t_nr].tile_update();
         }
+        ///  \brief same as above, obs is told about the bonds that change (see no_observer_struct)
+        template<typename O>
+        bool tile_update(state_type const & state, unsigned const & t_nr, O & obs) {
+            return tile[state][t_nr].tile_update(obs);
+        }
         ///  \brief for the checkpoints
         ///  
         ///  this function is used by the serializer to get and set this object
@@ -187,9 +192,10 @@ namespace perimeter_rvb {
         shift_type shift_region[qmc::n_shifts]; ///< says by how much the state has to be permuted for the various shift_modes
         tile_type tile[qmc::n_states][tile_type::tile_per_site]; ///< the tiles that are managed by this site
         
-        static shift_type shift_mode_print; ///< for nicer printing
-        static unsigned print_alternate; ///< for nicer printing
-        static bond_type last_dir; ///< for tracking the sign. Shows the direction of the last loop_partner return
+        //thread_local, s.t. grids on different threads (chain_class) don't interfere
+        static thread_local shift_type shift_mode_print; ///< for nicer printing
+        static thread_local unsigned print_alternate; ///< for nicer printing
+        static thread_local bond_type last_dir; ///< for tracking the sign. Shows the direction of the last loop_partner return
         
     private:
         ///  \brief plots the bonds in differente colors, depending how the config is
@@ -264,9 +270,9 @@ namespace perimeter_rvb {
         }
     };
     
-    shift_type site_struct::shift_mode_print = qmc::no_shift;
-    unsigned site_struct::print_alternate = 1;
-    bond_type site_struct::last_dir = 1;
+    thread_local shift_type site_struct::shift_mode_print = qmc::no_shift;
+    thread_local unsigned site_struct::print_alternate = 1;
+    thread_local bond_type site_struct::last_dir = 1;
     
     std::ostream & operator<<(std::ostream & os, site_struct const & site) {
         site.print(qmc::start_state, os);
@@ -0,0 +1,238 @@
+// Author:  Mario S. Könz <mskoenz@gmx.net>
+// Date:    19.10.2026 20:41:05 EDT
+// File:    snapshot_stream.hpp
+
+#ifndef __SNAPSHOT_STREAM_HEADER
+#define __SNAPSHOT_STREAM_HEADER
+
+/* minimal code
+
+#include <snapshot_stream.hpp>
+perimeter_rvb::snapshot_writer_class writer("snapshots.bin", H, L);
+writer.write(grid, sweep); //false (and nothing is written) if the writer lags behind
+writer.flush(); //waits until everything is in the file
+uint64_t bytes = writer.size(); //after flush, the stream up to here
+writer.truncate(bytes); //drops the frames written after it
+
+perimeter_rvb::snapshot_reader_class reader("snapshots.bin");
+perimeter_rvb::snapshot_frame_struct frame;
+while(reader.next(frame))
+    std::cout << frame.sweep << " " << frame.bond(state, i, j) << " " << frame.spin(state, i, j) << std::endl;
+
+*/
+
+#include <grid_class.hpp>
+
+#include <snapshot_ring_msk.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+//perimeter is documented in grid_class.hpp
+namespace perimeter_rvb {
+    ///  \brief one configuration of a snapshot stream, see snapshot_writer_class for the file format
+    ///
+    ///  the lattice is in the header and the reader doesn't use qmc, so a reader built for one grid type reads
+    ///  the streams of all of them
+    struct snapshot_frame_struct {
+        static uint32_t const magic = 0x4e534251;   ///< "QBSN" in the file
+        static uint8_t const version = 1;
+        static unsigned const header_size = 32;     ///< bytes
+
+        uint8_t lattice;        ///< 3 tri, 4 sqr, 6 hex (GRID_TYPE)
+        uint8_t n_states;
+        uint8_t bond_bits;      ///< bits per bond
+        uint8_t bond_offset;    ///< the bond enum value of code 0 (qmc::start_bond)
+        uint32_t H;
+        uint32_t L;
+        uint64_t sweep;
+        std::vector<uint8_t> bond_code; ///< bond - bond_offset, (i * L + j) * n_states + state
+        std::vector<uint8_t> spin_code; ///< 0 beta, 1 alpha, same layout
+
+        ///  \brief the bond enum value (qmc::bond_enum of the lattice) of site (i, j) in state
+        unsigned bond(unsigned const & state, unsigned const & i, unsigned const & j) const {
+            return bond_code[(i * L + j) * n_states + state] + bond_offset;
+        }
+        unsigned spin(unsigned const & state, unsigned const & i, unsigned const & j) const {
+            return spin_code[(i * L + j) * n_states + state];
+        }
+        ///  \brief bytes of the packed bonds and spins that follow the header
+        uint64_t body_size() const {
+            uint64_t const n = uint64_t(H) * L * n_states;
+            return (n * bond_bits + 7) / 8 + (n + 7) / 8;
+        }
+    };
+    ///  \brief appends configurations to a binary stream file without stalling the simulation
+    ///
+    ///  write only copies bonds and spins to a free slot, one background thread packs and appends them. If all
+    ///  slots are in use the configuration is dropped instead of waiting (see dropped). The file is opened
+    ///  in append mode, so a run that continues from a checkpoint continues the stream. sim_class keeps the
+    ///  size at the checkpoint and truncates to it, s.t. the sweeps after the checkpoint don't appear twice.
+    ///
+    ///  Every frame is a header of 32 bytes followed by the body, all integers are little endian:
+    ///
+    ///      byte  0: uint32 magic            byte  8: uint8 bond_offset (3 bytes padding)
+    ///      byte  4: uint8 version           byte 12: uint32 H
+    ///      byte  5: uint8 lattice           byte 16: uint32 L (4 bytes padding)
+    ///      byte  6: uint8 n_states          byte 24: uint64 sweep
+    ///      byte  7: uint8 bond_bits
+    ///
+    ///  The body holds bond_bits bits per bond (2 on sqr and hex, 3 on tri) for all sites and states in the
+    ///  order (i * L + j) * n_states + state, the lowest bits first, padded to a full byte. The spins
+    ///  follow with 1 bit each in the same order and are again padded to a full byte
+    class snapshot_writer_class {
+        ///  \brief a copy of the configuration that waits for the writer thread
+        struct frame_struct {
+            grid_class::snapshot_struct config;
+            uint64_t sweep;
+        };
+    public:
+        ///  @param file is opened in append mode
+        ///  @param n_slots is the amount of configurations that can wait for the writer thread
+        snapshot_writer_class(std::string const & file, unsigned const & H, unsigned const & L, unsigned const & n_slots = 4):
+                  file_(file)
+                , ofs_(file, std::ios::binary | std::ios::app)
+                , H_(H)
+                , L_(L)
+                , ring_(n_slots, 1, [this](frame_struct const & frame, unsigned const & worker) {return append(frame);}) {
+            if(not ofs_)
+                throw std::runtime_error("snapshot_writer_class: can't open " + file);
+        }
+        ///  \brief hands the configuration of grid to the writer thread, false if it was dropped
+        bool write(grid_class & grid, uint64_t const & sweep) {
+            ring_.collect([](bool const & ok) {});
+            return ring_.publish([&](frame_struct & frame) {grid.save_snapshot(frame.config); frame.sweep = sweep;});
+        }
+        ///  \brief waits for all handed configurations and flushes the file
+        void flush() {
+            ring_.drain([](bool const & ok) {});
+            ofs_.flush();
+        }
+        ///  \brief bytes in the file, after flush this includes all handed configurations
+        uint64_t size() const {
+            struct stat st;
+            if(stat(file_.c_str(), &st) != 0)
+                return 0;
+            return st.st_size;
+        }
+        ///  \brief waits for the writer thread and drops everything after the first n bytes
+        ///
+        ///  used after loading a checkpoint, the frames written after it are written again
+        void truncate(uint64_t const & n) {
+            flush();
+            if(size() > n and ::truncate(file_.c_str(), n) != 0)
+                throw std::runtime_error("snapshot_writer_class: cannot truncate " + file_);
+        }
+        ///  \brief amount of configurations that were dropped because the writer thread lagged behind
+        uint64_t dropped() const {
+            return ring_.skipped();
+        }
+        ~snapshot_writer_class() {
+            flush();
+        }
+    private:
+        ///  \brief packs and appends one frame, runs on the writer thread
+        bool append(frame_struct const & frame) {
+            uint64_t const n = frame.config.bond.size();
+            std::vector<uint8_t> buffer(snapshot_frame_struct::header_size, 0);
+            put(buffer, 0, snapshot_frame_struct::magic, 4);
+            buffer[4] = snapshot_frame_struct::version;
+            buffer[5] = GRID_TYPE;
+            buffer[6] = qmc::n_states;
+            buffer[7] = bond_bits;
+            buffer[8] = qmc::start_bond;
+            put(buffer, 12, H_, 4);
+            put(buffer, 16, L_, 4);
+            put(buffer, 24, frame.sweep, 8);
+
+            uint64_t const bond_bytes = (n * bond_bits + 7) / 8;
+            buffer.resize(snapshot_frame_struct::header_size + bond_bytes + (n + 7) / 8, 0);
+            uint8_t * const body = &buffer[snapshot_frame_struct::header_size];
+            for(uint64_t k = 0; k < n; ++k) {
+                uint64_t const code = frame.config.bond[k] - qmc::start_bond;
+                uint64_t const bit = k * bond_bits;
+                body[bit / 8] |= code << (bit % 8);
+                if(bit % 8 + bond_bits > 8) //the code spans two bytes
+                    body[bit / 8 + 1] |= code >> (8 - bit % 8);
+                body[bond_bytes + k / 8] |= (frame.config.spin[k] == qmc::alpha) << (k % 8);
+            }
+            ofs_.write(reinterpret_cast<char const *>(buffer.data()), buffer.size());
+            return bool(ofs_);
+        }
+        static void put(std::vector<uint8_t> & buffer, unsigned const & pos, uint64_t const & value, unsigned const & bytes) {
+            for(unsigned b = 0; b < bytes; ++b)
+                buffer[pos + b] = (value >> (8 * b)) & 0xff;
+        }
+        ///  \brief bits per bond, enough for the n_bonds - start_bond directions
+        static uint8_t const bond_bits = qmc::n_bonds - qmc::start_bond > 4 ? 3 : 2;
+    private:
+        std::string const file_;
+        std::ofstream ofs_;
+        unsigned const H_;
+        unsigned const L_;
+        addon::snapshot_ring_class<frame_struct, bool> ring_; ///< one worker, so the frames stay in order
+    };
+    ///  \brief reads the frames of a stream written by snapshot_writer_class one after the other
+    class snapshot_reader_class {
+    public:
+        snapshot_reader_class(std::string const & file): ifs_(file, std::ios::binary) {
+            if(not ifs_)
+                throw std::runtime_error("snapshot_reader_class: can't open " + file);
+        }
+        ///  \brief reads the next frame, false at the end of the stream
+        ///
+        ///  throws if the stream is damaged (wrong magic or version, or a truncated frame)
+        bool next(snapshot_frame_struct & frame) {
+            std::vector<uint8_t> buffer(snapshot_frame_struct::header_size);
+            if(not ifs_.read(reinterpret_cast<char *>(buffer.data()), buffer.size())) {
+                if(ifs_.gcount() == 0)
+                    return false;
+                throw std::runtime_error("snapshot_reader_class: truncated header");
+            }
+            if(get(buffer, 0, 4) != snapshot_frame_struct::magic or buffer[4] != snapshot_frame_struct::version)
+                throw std::runtime_error("snapshot_reader_class: not a snapshot stream or unknown version");
+            frame.lattice = buffer[5];
+            frame.n_states = buffer[6];
+            frame.bond_bits = buffer[7];
+            frame.bond_offset = buffer[8];
+            frame.H = get(buffer, 12, 4);
+            frame.L = get(buffer, 16, 4);
+            frame.sweep = get(buffer, 24, 8);
+
+            buffer.resize(frame.body_size());
+            if(not ifs_.read(reinterpret_cast<char *>(buffer.data()), buffer.size()))
+                throw std::runtime_error("snapshot_reader_class: truncated frame");
+
+            uint64_t const n = uint64_t(frame.H) * frame.L * frame.n_states;
+            uint64_t const bond_bytes = (n * frame.bond_bits + 7) / 8;
+            unsigned const mask = (1u << frame.bond_bits) - 1;
+            frame.bond_code.resize(n);
+            frame.spin_code.resize(n);
+            for(uint64_t k = 0; k < n; ++k) {
+                uint64_t const bit = k * frame.bond_bits;
+                unsigned code = buffer[bit / 8] >> (bit % 8);
+                if(bit % 8 + frame.bond_bits > 8)
+                    code |= unsigned(buffer[bit / 8 + 1]) << (8 - bit % 8);
+                frame.bond_code[k] = code & mask;
+                frame.spin_code[k] = (buffer[bond_bytes + k / 8] >> (k % 8)) & 1;
+            }
+            return true;
+        }
+    private:
+        static uint64_t get(std::vector<uint8_t> const & buffer, unsigned const & pos, unsigned const & bytes) {
+            uint64_t res = 0;
+            for(unsigned b = 0; b < bytes; ++b)
+                res |= uint64_t(buffer[pos + b]) << (8 * b);
+            return res;
+        }
+    private:
+        std::ifstream ifs_;
+    };
+}//end namespace perimeter_rvb
+#endif //__SNAPSHOT_STREAM_HEADER
@@ -0,0 +1,125 @@
+// Author:  Mario S. Könz <mskoenz@gmx.net>
+// Date:    19.10.2026 11:20:43 EDT
+// File:    therm_class.hpp
+
+#ifndef __THERM_CLASS_HEADER
+#define __THERM_CLASS_HEADER
+
+#include <vector>
+#include <cmath>
+#include <assert.h>
+#include <algorithm>
+
+//perimeter is documented in grid_class.hpp
+namespace perimeter_rvb {
+    ///  \brief decides when the thermalization is over
+    ///
+    ///  The samples of every observable are collected in windows. When a window is full, its mean, the error
+    ///  of the mean and the autocorrelation time tau are estimated with n_blocks blocks. The thermalization
+    ///  is over, if for all observables the drift between the means of the last two windows is smaller than
+    ///  tol times their combined error and the window is at least tau_factor * tau long.
+    ///  Otherwise the window size doubles and the next window begins.
+    class therm_class {
+        ///  \brief the estimates of one observable in one window
+        struct window_struct {
+            double mean;
+            double error;
+            double tau;
+        };
+    public:
+        static unsigned const n_blocks = 16; ///< amount of blocks per window for error and tau
+        ///  \brief the only constructor
+        ///
+        ///  @param n_obs is the amount of observables that are tracked
+        ///  @param window is the size of the first window (at least 2 * n_blocks)
+        ///  @param tol is the allowed drift in units of the error
+        ///  @param tau_factor is the minimal window size in units of tau
+        therm_class(unsigned const & n_obs, unsigned const & window, double const & tol, double const & tau_factor):
+                                                                          window_(std::max(window, 2 * n_blocks))
+                                                                        , tol_(tol)
+                                                                        , tau_factor_(tau_factor)
+                                                                        , cur_(n_obs)
+                                                                        , last_(n_obs)
+                                                                        , has_last_(false)
+                                                                        , tau_(0) {
+        }
+        ///  \brief adds one sample per observable and returns true if the thermalization is over
+        bool add(std::vector<double> const & sample) {
+            assert(sample.size() == cur_.size());
+            for(unsigned i = 0; i < cur_.size(); ++i)
+                cur_[i].push_back(sample[i]);
+
+            if(cur_[0].size() < window_)
+                return false;
+
+            bool done = has_last_;
+            tau_ = 0;
+            for(unsigned i = 0; i < cur_.size(); ++i) {
+                window_struct w = estimate(cur_[i]);
+                tau_ = std::max(tau_, w.tau);
+
+                if(has_last_) {
+                    double drift = std::abs(w.mean - last_[i].mean);
+                    double error = std::sqrt(w.error * w.error + last_[i].error * last_[i].error);
+                    done = done and drift <= tol_ * error and window_ >= tau_factor_ * w.tau;
+                }
+                last_[i] = w;
+                cur_[i].clear();
+            }
+            has_last_ = true;
+
+            if(not done)
+                window_ *= 2;
+            return done;
+        }
+        ///  \brief size of the current window
+        unsigned window() const {
+            return window_;
+        }
+        ///  \brief the largest tau of all observables in the last full window
+        double tau() const {
+            return tau_;
+        }
+    private:
+        ///  \brief block estimate of mean, error and tau
+        ///
+        ///  tau = (blocksize * var(block means) / var(samples) - 1) / 2, which is the integrated
+        ///  autocorrelation time if the blocks are longer than tau
+        static window_struct estimate(std::vector<double> const & s) {
+            unsigned const bs = s.size() / n_blocks;
+            double sum = 0;
+            double sq_sum = 0;
+            double b_sum = 0;
+            double b_sq_sum = 0;
+            for(unsigned b = 0; b < n_blocks; ++b) {
+                double block = 0;
+                for(unsigned k = b * bs; k < (b + 1) * bs; ++k) {
+                    block += s[k];
+                    sq_sum += s[k] * s[k];
+                }
+                sum += block;
+                block /= bs;
+                b_sum += block;
+                b_sq_sum += block * block;
+            }
+            unsigned const n = bs * n_blocks;
+            window_struct w;
+            w.mean = sum / n;
+            double var = sq_sum / n - w.mean * w.mean;
+            double b_var = std::max(0.0, b_sq_sum / n_blocks - w.mean * w.mean);
+
+            w.error = std::sqrt(b_var / (n_blocks - 1));
+            w.tau = var > 0 ? std::max(0.0, (bs * b_var / var - 1) / 2) : 0;
+            return w;
+        }
+    private:
+        unsigned window_;   ///< size of the current window
+        double const tol_;  ///< allowed drift in units of the error
+        double const tau_factor_; ///< minimal window size in units of tau
+        std::vector<std::vector<double>> cur_; ///< samples of the current window per observable
+        std::vector<window_struct> last_;   ///< estimates of the last window per observable
+        bool has_last_;     ///< false until the first window is done
+        double tau_;        ///< largest tau of the last window
+    };
+}//end namespace perimeter_rvb
+#endif //__THERM_CLASS_HEADER
@@ -10,6 +10,16 @@
 #include <bitset>
 
 namespace perimeter_rvb {
+    ///  \brief observer for tile_update that does nothing
+    ///  
+    ///  An observer is called as obs(state, a, b, w) for the bond of a to b in state. tile_update calls it with w = -1
+    ///  for every site of the tile before and with w = +1 after the bonds change, so every bond is seen from both
+    ///  ends and a removed (added) bond sums up to w = -2 (+2). The loop_bond_update uses w = -2 and +2 directly
+    struct no_observer_struct {
+        template<typename S>
+        void operator()(state_type const & state, S const * a, S const * b, int const & w) const {
+        }
+    };
     ///  \brief empty general template to represent the tiles
     template<typename site_type, int T>
     struct tile_struct {
@@ -37,6 +47,7 @@ namespace perimeter_rvb {
         //------------------- constants -------------------
         static unsigned const tile_per_site = 1;
         static unsigned const n_patterns = 2;
+        static unsigned const reach = 2; ///< a tile reads bonds of sites that are at most reach steps away
         
         ///  \brief the legal bond pattern
         ///  
@@ -84,6 +95,12 @@ namespace perimeter_rvb {
         ///  
         ///  returns true if success
         bool tile_update() {
+            no_observer_struct obs;
+            return tile_update(obs);
+        }
+        ///  \brief updates the tile if possible and tells obs about the bonds that change (see no_observer_struct)
+        template<typename O>
+        bool tile_update(O & obs) {
             if(alpha < qmc::all_good) {
                 assert(site != NULL);
                 if(alpha == 0) { //is spin unchecked
@@ -101,7 +118,10 @@ namespace perimeter_rvb {
                 site_type * const pos3 = pos2->neighbor[qmc::down];
                 site_type * const pos4 = pos3->neighbor[qmc::down];
                 site_type * const pos5 = pos4->neighbor[qmc::hori];
+                site_type * const sites[] = {site, pos1, pos2, pos3, pos4, pos5};
                 
+                for(site_type * s: sites)
+                    obs(state, s, s->partner(state), -1);
                 
                 //~ site->bond[state] = base0_     + base1_ -     site->bond[state];
                 
@@ -112,6 +132,9 @@ namespace perimeter_rvb {
                 pos4->bond[state] = qmc::up   + qmc::hori - pos4->bond[state];
                 pos5->bond[state] = qmc::up   + qmc::hori - pos5->bond[state];
                 
+                for(site_type * s: sites)
+                    obs(state, s, s->partner(state), +1);
+                
                 flip();
                 //------------------- change neighbor tiles -------------------
                 //i
@@ -151,18 +174,30 @@ namespace perimeter_rvb {
             state = _state;
             site = _site;
             alpha = 0;
-            reset();
-
             
+            read_bonds();
+            check_bad_bond();
+            check_bad_spin();
+        }
+        ///  \brief sets the bits according to the bonds around the tile
+        void read_bonds() {
+            reset();
             set(bond0, site->bond[state] == qmc::up);
             set(bond1, site->neighbor[qmc::up  ]->bond[state] == qmc::hori);
             set(bond2, site->neighbor[qmc::up  ]->neighbor[qmc::hori]->bond[state] == qmc::down);
             set(bond3, site->neighbor[qmc::down]->neighbor[qmc::hori]->bond[state] == qmc::up);
             set(bond4, site->neighbor[qmc::down]->bond[state] == qmc::hori);
             set(bond5, site->bond[state] == qmc::down);
-            
+        }
+        ///  \brief brings the tile up to date after the bonds were changed by someone else
+        ///  
+        ///  the spin check is cleared and will be done lazily in tile_update
+        void refresh() {
+            if(alpha == qmc::not_used)
+                return;
+            read_bonds();
+            CLEAR_BIT(alpha, qmc::clear)
             check_bad_bond();
-            check_bad_spin();
         }
         ///  \brief for the checkpoints
         ///  
@@ -194,6 +229,7 @@ namespace perimeter_rvb {
         //------------------- constants -------------------
         static unsigned const tile_per_site = 3;
         static unsigned const n_patterns = 2;
+        static unsigned const reach = 1; ///< a tile reads bonds of sites that are at most reach steps away
         ///  \brief the legal bond pattern
         ///  
         ///  0 = no bond, 1 = bond
@@ -233,6 +269,12 @@ namespace perimeter_rvb {
         ///  
         ///  returns true if success
         bool tile_update() {
+            no_observer_struct obs;
+            return tile_update(obs);
+        }
+        ///  \brief updates the tile if possible and tells obs about the bonds that change (see no_observer_struct)
+        template<typename O>
+        bool tile_update(O & obs) {
             //~ DEBUG_VAR(alpha)
             if(alpha < qmc::all_good) {
                 if(alpha == 0) {
@@ -245,12 +287,18 @@ namespace perimeter_rvb {
                 site_type * const bas0 = site->neighbor[base0_];
                 site_type * const bas1 = site->neighbor[base1_];
                 site_type * const diag = site->neighbor[diag_];
+                site_type * const sites[] = {site, bas0, bas1, diag};
                 
+                for(site_type * s: sites)
+                    obs(state, s, s->partner(state), -1);
                 
                 site->bond[state] = base0_     + base1_     - site->bond[state];
                 bas1->bond[state] = base0_     + base1_inv_ - bas1->bond[state];
                 bas0->bond[state] = base0_inv_ + base1_     - bas0->bond[state];
                 diag->bond[state] = base0_inv_ + base1_inv_ - diag->bond[state];
+                
+                for(site_type * s: sites)
+                    obs(state, s, s->partner(state), +1);
 
                 flip();
                 (*this) &= ~patterns[idx][2]; //mask stuff that has to remain zero
@@ -328,13 +376,25 @@ namespace perimeter_rvb {
             base1_inv_ = qmc::invert_bond - base1_;
             diag_inv_ = qmc::invert_bond - diag_;
             
+            read_bonds();
+            check_bad_bond();
+            check_bad_spin();
+        }
+        ///  \brief sets the bits according to the bonds around the tile
+        void read_bonds() {
+            reset();
             set(base0_,  site->bond[state] == base1_);
             set(base1_, site->bond[state] == base0_);
             set(base1_inv_,  site->neighbor[base1_]->bond[state] == base0_);
             set(base0_inv_,    site->neighbor[base0_ ]->bond[state] == base1_);
-            
+        }
+        ///  \brief brings the tile up to date after the bonds were changed by someone else
+        ///  
+        ///  the spin check is cleared and will be done lazily in tile_update
+        void refresh() {
+            read_bonds();
+            CLEAR_BIT(alpha, qmc::clear)
             check_bad_bond();
-            check_bad_spin();
         }
         ///  \brief for the checkpoints
         ///  
@@ -387,6 +447,7 @@ namespace perimeter_rvb {
         //------------------- constants -------------------
         static unsigned const tile_per_site = 1;
         static unsigned const n_patterns = 2;
+        static unsigned const reach = 1; ///< a tile reads bonds of sites that are at most reach steps away
         ///  \brief the legal bond pattern
         ///  
         ///  0 = no bond, 1 = bond legal are 0101 and 1010
@@ -424,6 +485,12 @@ namespace perimeter_rvb {
         ///  
         ///  returns true if success
         bool tile_update() {
+            no_observer_struct obs;
+            return tile_update(obs);
+        }
+        ///  \brief updates the tile if possible and tells obs about the bonds that change (see no_observer_struct)
+        template<typename O>
+        bool tile_update(O & obs) {
             if(alpha < qmc::all_good) {
                 if(alpha == 0) {
                     check_bad_spin_tile(site, site->neighbor[qmc::down + qmc::right - site->bond[state]]); //lazy check :-)
@@ -436,13 +503,19 @@ namespace perimeter_rvb {
                 site_type * const bas0 = site->neighbor[qmc::down];
                 site_type * const bas1 = site->neighbor[qmc::right];
                 site_type * const diag = bas1->neighbor[qmc::down];
+                site_type * const sites[] = {site, bas0, bas1, diag};
                 
+                for(site_type * s: sites)
+                    obs(state, s, s->partner(state), -1);
                 
                 site->bond[state] = qmc::down + qmc::right - site->bond[state];
                 bas1->bond[state] = qmc::down + qmc::left  - bas1->bond[state];
                 bas0->bond[state] = qmc::up   + qmc::right - bas0->bond[state];
                 diag->bond[state] = qmc::up   + qmc::left  - diag->bond[state];
                 
+                for(site_type * s: sites)
+                    obs(state, s, s->partner(state), +1);
+                
                 flip();
                 reset(0);
                 
@@ -463,13 +536,25 @@ namespace perimeter_rvb {
             state = _state;
             site = _site;
             
+            read_bonds();
+            check_bad_bond();
+            check_bad_spin();
+        }
+        ///  \brief sets the bits according to the bonds around the tile
+        void read_bonds() {
+            reset();
             set(qmc::down,  site->bond[state] == qmc::right);
             set(qmc::right, site->bond[state] == qmc::down);
             set(qmc::left,  site->neighbor[qmc::right]->bond[state] == qmc::down);
             set(qmc::up,    site->neighbor[qmc::down ]->bond[state] == qmc::right);
-            
+        }
+        ///  \brief brings the tile up to date after the bonds were changed by someone else
+        ///  
+        ///  the spin check is cleared and will be done lazily in tile_update
+        void refresh() {
+            read_bonds();
+            CLEAR_BIT(alpha, qmc::clear)
             check_bad_bond();
-            check_bad_spin();
         }
         ///  \brief for the checkpoints
         ///  
@@ -3,10 +3,409 @@
 // File:    test_1.cpp
 
 #include <iostream>
+#include <cstdio>
+#include <sstream>
+#include <fstream>
+#include <numeric>
 #include <sim_class.hpp>
 
+//=================== serializer round trip ===================
+struct point_struct { //not bulk, has serialize
+    template<typename Archive>
+    void serialize(Archive & ar) {
+        ar & x;
+        ar & name;
+    }
+    bool operator==(point_struct const & other) const {
+        return x == other.x and name == other.name;
+    }
+    double x;
+    std::string name;
+};
+
+unsigned failed = 0;
+
+///  \brief writes in, reads it back to out and compares
+template<typename T>
+void round_trip(std::string const & what, T const & in, T & out) {
+    std::stringstream ss;
+    addon::oss_class<std::stringstream> oss(ss);
+    T copy(in);
+    oss & copy;
+    addon::iss_class<std::stringstream> iss(ss);
+    iss & out;
+    bool const ok = (out == in) and ss.peek() == std::char_traits<char>::eof();
+    if(not ok)
+        ++failed;
+    std::cout << (ok ? "ok     " : "FAILED ") << what << std::endl;
+}
+template<typename T>
+void round_trip(std::string const & what, T const & in) {
+    T out;
+    round_trip(what, in, out);
+}
+template<typename T, std::size_t N>
+bool equal(T const (& a)[N], T const (& b)[N]) {
+    return std::equal(a, a + N, b);
+}
+template<std::size_t N>
+void bitset_round_trip() {
+    std::bitset<N> in;
+    for(std::size_t i = 0; i < N; i += 3)
+        in[i] = 1;
+    in[N - 1] = 1;
+    round_trip("bitset<" + std::to_string(N) + ">", in);
+}
+void report(std::string const & what, bool const & ok) {
+    if(not ok)
+        ++failed;
+    std::cout << (ok ? "ok     " : "FAILED ") << what << std::endl;
+}
+
+//=================== statistics ===================
+using namespace perimeter_rvb;
+
+///  \brief deterministic uniform numbers in [0, 1) (a 64 bit lcg), s.t. the tests don't depend on the rng
+struct lcg_struct {
+    lcg_struct(uint64_t const & seed): state(seed) {
+    }
+    double operator()() {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return (state >> 11) * (1.0 / 9007199254740992.0);
+    }
+    uint64_t state;
+};
+bool close(double const & a, double const & b, double const & rel = 1e-10) {
+    return std::abs(a - b) <= rel * std::max(std::abs(a), std::abs(b));
+}
+///  \brief error(l) and tau of accumulator_binning against bins of 2^l samples formed by hand
+void binning_test() {
+    //ar(1) process x' = rho x + u, tau = rho / (1 - rho) = 9
+    lcg_struct rng(1);
+    std::vector<double> x(1 << 16);
+    double v = 0;
+    for(unsigned k = 0; k < x.size(); ++k)
+        x[k] = v = .9 * v + rng() - .5;
+
+    accumulator_binning acc;
+    for(unsigned k = 0; k < x.size(); ++k)
+        acc << x[k];
+
+    bool ok = acc.count() == x.size() and acc.levels() == 10; //level 9 has 128 bins
+    std::vector<double> err;
+    for(unsigned l = 0; (x.size() >> l) >= 2; ++l) {
+        uint64_t const size = uint64_t(1) << l;
+        uint64_t const n = x.size() / size;
+        double sum = 0, sum2 = 0;
+        for(uint64_t b = 0; b < n; ++b) {
+            double const mean = std::accumulate(&x[b * size], &x[b * size] + size, 0.0) / size;
+            sum += mean;
+            sum2 += mean * mean;
+        }
+        double const m = sum / n;
+        err.push_back(std::sqrt((sum2 / n - m * m) / (n - 1)));
+        ok = ok and close(acc.error(l), err[l], 1e-8);
+    }
+    ok = ok and close(acc.error(), err[acc.levels() - 1], 1e-8) and acc.error(err.size()) == 0;
+    double const e = err[acc.levels() - 1];
+    ok = ok and close(acc.tau(), (e * e / err[0] / err[0] - 1) / 2, 1e-8);
+    ok = ok and acc.tau() > 5 and acc.tau() < 15 and acc.converged(); //9 within the error of 128 bins
+    report("binning error per level and tau", ok);
+
+    //the same with fewer samples than one level needs
+    accumulator_binning few;
+    few << 1;
+    ok = few.levels() == 0 and few.error() == 0 and few.tau() == 0 and not few.converged();
+    report("binning with one sample", ok);
+}
+
+///  \brief jackknife of means[0] / means[1] over blocks of 4 records formed by hand
+void jackknife_test() {
+    lcg_struct rng(2);
+    std::vector<std::vector<double>> rec(13);
+    for(unsigned r = 0; r < rec.size(); ++r)
+        rec[r] = {rng(), 1 + rng()};
+    auto const ratio = [](std::vector<double> const & means) {return means[0] / means[1];};
+
+    jackknife_class jack(2, 4); //merges after 4 and 8 records: blocks of 4, 4, 4, 1
+    for(unsigned r = 0; r < rec.size(); ++r)
+        jack.add(rec[r]);
+    std::vector<double> fjack;
+    for(unsigned k = 0; k < 4; ++k) {
+        double sum[2] = {0, 0};
+        unsigned n = 0;
+        for(unsigned r = 0; r < rec.size(); ++r)
+            if(r / 4 != k) {
+                sum[0] += rec[r][0];
+                sum[1] += rec[r][1];
+                ++n;
+            }
+        fjack.push_back(ratio({sum[0] / n, sum[1] / n}));
+    }
+    double const mean = std::accumulate(fjack.begin(), fjack.end(), 0.0) / 4;
+    double var = 0;
+    for(unsigned k = 0; k < 4; ++k)
+        var += (fjack[k] - mean) * (fjack[k] - mean);
+    auto const res = jack(ratio);
+    report("jackknife block merging", jack.count() == rec.size() and close(res.first, mean) and close(res.second, std::sqrt(var * 3 / 4)));
+
+    jackknife_class single(2);
+    single.add(rec[0]);
+    auto const one = single(ratio);
+    report("jackknife with a single block", close(one.first, rec[0][0] / rec[0][1]) and one.second == 0);
+}
+
+///  \brief accumulator_log against the direct sums of 2^x
+void log_test() {
+    lcg_struct rng(3);
+    std::vector<double> x(1000);
+    for(unsigned k = 0; k < x.size(); ++k)
+        x[k] = 40 * rng() - 20;
+
+    accumulator_log acc, first, second, shifted;
+    double sum = 0, sum2 = 0;
+    for(unsigned k = 0; k < x.size(); ++k) {
+        acc << x[k];
+        (k < 300 ? first : second) << x[k];
+        shifted << x[k] + 3000; //2^3000 overflows a double
+        sum += std::exp2(x[k]);
+        sum2 += std::exp2(2 * x[k]);
+    }
+    unsigned const n = x.size();
+    double const mean = sum / n;
+    double const error = std::sqrt((sum2 / n - mean * mean) / (n - 1)) / mean / std::log(2.0);
+    bool ok = close(acc.log_sum(), std::log2(sum)) and close(acc.log_mean(), std::log2(mean));
+    ok = ok and close(acc.mean(), mean) and close(acc.log_error(), error);
+    report("log accumulator vs direct sum", ok);
+
+    first.merge(second);
+    ok = first.count() == n and close(first.log_mean(), acc.log_mean()) and close(first.log_error(), acc.log_error());
+    ok = ok and close(shifted.log_mean(), acc.log_mean() + 3000) and close(shifted.log_error(), acc.log_error(), 1e-8);
+    report("log accumulator merge and large exponents", ok);
+}
+///  \brief jackknife of log observables against the one of the plain values
+void log_jackknife_test() {
+    lcg_struct rng(4);
+    jackknife_class plain(2, 4);
+    jackknife_class log(std::vector<bool>{true, false}, 4);
+    for(unsigned r = 0; r < 13; ++r) {
+        double const a = 1 + rng(), b = rng();
+        plain.add({a, b});
+        log.add({std::log2(a), b});
+    }
+    auto const p = plain([](std::vector<double> const & means) {return std::log2(means[0]) - means[1];});
+    auto const l = log([](std::vector<double> const & means) {return means[0] - means[1];});
+    report("jackknife log block merging", close(p.first, l.first) and close(p.second, l.second, 1e-8));
+
+    //the first block holds all of the total up to 2^-200, leaving it out must not give log2(0)
+    jackknife_class dominant(std::vector<bool>{true});
+    std::vector<double> const x{200, 0, 0, 0};
+    for(unsigned r = 0; r < x.size(); ++r)
+        dominant.add({x[r]});
+    auto const d = dominant([](std::vector<double> const & means) {return means[0];});
+    double const rest = 200 - std::log2(3.0); //leave out one of the 2^0
+    double const mean = rest * 3 / 4; //leaving out 2^200 gives log2(3 / 3) = 0
+    report("jackknife log with a dominant block", std::isfinite(d.first) and close(d.first, mean) and close(d.second, std::sqrt(3 * (rest * rest * 3 / 4 - mean * mean))));
+}
+
+//=================== fft ===================
+///  \brief real_pair and the inverse transform of fft_2d_class against the direct sum
+void fft_test(unsigned const & H, unsigned const & L) {
+    typedef std::complex<double> complex_type;
+    lcg_struct rng(5 + H * L);
+    std::vector<double> a(H * L), b(H * L);
+    for(unsigned k = 0; k < H * L; ++k) {
+        a[k] = rng() - .5;
+        b[k] = rng() - .5;
+    }
+    addon::fft_2d_class fft(H, L);
+    std::vector<complex_type> fa, fb;
+    fft.real_pair(a, b, fa, fb);
+
+    double dev = 0;
+    for(unsigned qi = 0; qi < H; ++qi)
+        for(unsigned qj = 0; qj < L; ++qj) {
+            complex_type da = 0, db = 0;
+            for(unsigned i = 0; i < H; ++i)
+                for(unsigned j = 0; j < L; ++j) {
+                    complex_type const w = std::polar(1.0, -2 * M_PI * (double(qi * i % H) / H + double(qj * j % L) / L));
+                    da += a[i * L + j] * w;
+                    db += b[i * L + j] * w;
+                }
+            dev = std::max(dev, std::abs(fa[qi * L + qj] - da));
+            dev = std::max(dev, std::abs(fb[qi * L + qj] - db));
+        }
+    std::vector<complex_type> z(fa);
+    fft(z, true);
+    for(unsigned k = 0; k < H * L; ++k)
+        dev = std::max(dev, std::abs(z[k] / double(H * L) - a[k]));
+    report("fft " + std::to_string(H) + "x" + std::to_string(L) + " vs direct sum", dev < 1e-10);
+}
+
+//=================== snapshot stream ===================
+
+///  \brief a deterministic pattern that uses all bond codes of the lattice and both spins
+void fill_pattern(grid_class & grid, unsigned const & H, unsigned const & L, unsigned const & seed) {
+    unsigned const n_codes = qmc::n_bonds - qmc::start_bond;
+    for(unsigned i = 0; i < H; ++i)
+        for(unsigned j = 0; j < L; ++j)
+            for(unsigned state = qmc::start_state; state < qmc::n_states; ++state) {
+                unsigned const k = (i * L + j) * qmc::n_states + state + seed;
+                grid(i, j).bond[state] = bond_type(qmc::start_bond + (k * 5 + k / 7) % n_codes);
+                grid(i, j).spin[state] = (k * 3 + k / 5) % 2 ? qmc::alpha : qmc::beta;
+            }
+}
+bool same_config(grid_class & grid, unsigned const & H, unsigned const & L, snapshot_frame_struct const & frame) {
+    bool ok = frame.lattice == GRID_TYPE and frame.n_states == qmc::n_states and frame.H == H and frame.L == L;
+    for(unsigned i = 0; ok and i < H; ++i)
+        for(unsigned j = 0; j < L; ++j)
+            for(unsigned state = qmc::start_state; state < qmc::n_states; ++state) {
+                ok = ok and frame.bond(state, i, j) == unsigned(grid(i, j).bond[state]);
+                ok = ok and frame.spin(state, i, j) == unsigned(grid(i, j).spin[state] == qmc::alpha);
+            }
+    return ok;
+}
+///  \brief reads all frames of file, true if it threw
+bool reading_throws(std::string const & file) {
+    snapshot_reader_class reader(file);
+    snapshot_frame_struct frame;
+    try {
+        while(reader.next(frame)) {}
+    } catch(std::runtime_error const &) {
+        return true;
+    }
+    return false;
+}
+void snapshot_round_trip() {
+    std::string const file = "test_1_snapshot.bin";
+    unsigned const H = 6, L = 6; //hex needs multiples of 6
+    std::remove(file.c_str());
+
+    grid_class a(H, L), b(H, L);
+    fill_pattern(a, H, L, 0);
+    fill_pattern(b, H, L, 11);
+    uint64_t frame_bytes;
+    {
+        snapshot_writer_class writer(file, H, L);
+        writer.write(a, 7);
+        writer.flush();
+        frame_bytes = writer.size();
+        writer.write(b, uint64_t(1) << 40);
+        writer.flush();
+    }
+    snapshot_reader_class reader(file);
+    snapshot_frame_struct frame;
+    bool ok = reader.next(frame) and frame.sweep == 7 and same_config(a, H, L, frame);
+    ok = ok and reader.next(frame) and frame.sweep == uint64_t(1) << 40 and same_config(b, H, L, frame);
+    ok = ok and not reader.next(frame);
+    report("snapshot write/read, " + std::to_string(frame.bond_bits) + " bits per bond", ok);
+
+    ok = (::truncate(file.c_str(), 2 * frame_bytes - 1) == 0) and reading_throws(file);
+    ok = ok and (::truncate(file.c_str(), frame_bytes + 10) == 0) and reading_throws(file);
+    ok = ok and (::truncate(file.c_str(), frame_bytes) == 0) and not reading_throws(file);
+    report("snapshot truncated frame throws", ok);
+
+    //3 x 3 sites with one state, 3 bits per bond: codes cross byte boundaries and both sections are padded
+    std::vector<uint8_t> codes{5, 0, 3, 7, 1, 6, 2, 4, 5};
+    std::vector<uint8_t> spins{1, 0, 0, 1, 1, 0, 1, 0, 1};
+    std::vector<uint8_t> buffer(snapshot_frame_struct::header_size + 4 + 2, 0);
+    uint32_t const magic = snapshot_frame_struct::magic;
+    for(unsigned b = 0; b < 4; ++b)
+        buffer[b] = (magic >> (8 * b)) & 0xff;
+    buffer[4] = snapshot_frame_struct::version;
+    buffer[5] = 3;
+    buffer[6] = 1;
+    buffer[7] = 3;
+    buffer[8] = 1;
+    buffer[12] = 3;
+    buffer[16] = 3;
+    buffer[24] = 42;
+    uint8_t * const body = &buffer[snapshot_frame_struct::header_size];
+    for(unsigned k = 0; k < codes.size(); ++k) {
+        for(unsigned bit = 0; bit < 3; ++bit)
+            body[(3 * k + bit) / 8] |= ((codes[k] >> bit) & 1) << ((3 * k + bit) % 8);
+        body[4 + k / 8] |= spins[k] << (k % 8);
+    }
+    std::remove(file.c_str());
+    std::ofstream(file, std::ios::binary).write(reinterpret_cast<char const *>(buffer.data()), buffer.size());
+    snapshot_reader_class odd_reader(file);
+    ok = odd_reader.next(frame) and frame.body_size() == 6 and frame.sweep == 42;
+    for(unsigned k = 0; ok and k < codes.size(); ++k)
+        ok = frame.bond(0, k / 3, k % 3) == codes[k] + 1u and frame.spin(0, k / 3, k % 3) == spins[k];
+    ok = ok and not odd_reader.next(frame);
+    report("snapshot odd site count", ok);
+    std::remove(file.c_str());
+}
+
 int main(int argc, char* argv[]) {
-    
-    
-    return 0;
+    round_trip("vector<double>", std::vector<double>{1.5, -2, 1e300, 0});
+    round_trip("vector<uint8_t> (empty)", std::vector<uint8_t>());
+    round_trip("vector<bool>", std::vector<bool>{true, false, false, true, true});
+    round_trip("vector<point_struct>", std::vector<point_struct>{{1, "a"}, {-3.5, "bc"}});
+    round_trip("vector<vector<int>>", std::vector<std::vector<int>>{{1, 2}, {}, {3}});
+    round_trip("map<string, int>", std::map<std::string, int>{{"a", 1}, {"b", -2}});
+
+    boost::multi_array<int, 2> ma_in(boost::extents[3][4]);
+    boost::multi_array<int, 2> ma_out(boost::extents[3][4]);
+    for(unsigned i = 0; i < ma_in.num_elements(); ++i)
+        ma_in.data()[i] = i * i - 7;
+    round_trip("multi_array<int, 2>", ma_in, ma_out);
+
+    boost::multi_array<std::vector<int>, 1> mv_in(boost::extents[2]);
+    boost::multi_array<std::vector<int>, 1> mv_out(boost::extents[2]);
+    mv_in[0] = {4, 5};
+    round_trip("multi_array<vector<int>, 1>", mv_in, mv_out);
+
+    //C arrays don't compare with ==, so they are checked by hand
+    std::stringstream ss;
+    addon::oss_class<std::stringstream> oss(ss);
+    addon::iss_class<std::stringstream> iss(ss);
+    double ca_in[3][2] = {{1, 2}, {3, 4}, {5, -6}};
+    double ca_out[3][2];
+    std::string cs_in[2] = {"x", "yz"};
+    std::string cs_out[2];
+    oss & ca_in;
+    oss & cs_in;
+    iss & ca_out;
+    iss & cs_out;
+    bool const c_ok = equal(ca_in[0], ca_out[0]) and equal(ca_in[2], ca_out[2]) and equal(cs_in, cs_out);
+    if(not c_ok)
+        ++failed;
+    std::cout << (c_ok ? "ok     " : "FAILED ") << "C arrays" << std::endl;
+
+    bitset_round_trip<6>();
+    bitset_round_trip<63>();
+    bitset_round_trip<64>();
+    bitset_round_trip<100>();
+    bitset_round_trip<128>();
+
+    //a block read as another type throws instead of misreading
+    std::stringstream ts;
+    addon::oss_class<std::stringstream> tos(ts);
+    addon::iss_class<std::stringstream> tis(ts);
+    std::vector<uint32_t> narrow{1, 2};
+    std::vector<uint64_t> wide;
+    tos & narrow;
+    bool thrown = false;
+    try {
+        tis & wide;
+    } catch(std::runtime_error const &) {
+        thrown = true;
+    }
+    if(not thrown)
+        ++failed;
+    std::cout << (thrown ? "ok     " : "FAILED ") << "type mismatch throws" << std::endl;
+
+    binning_test();
+    jackknife_test();
+    log_test();
+    log_jackknife_test();
+    fft_test(8, 8);
+    fft_test(16, 4);
+    fft_test(6, 10);
+    fft_test(12, 8);
+    fft_test(3, 5);
+    snapshot_round_trip();
+
+    return failed == 0 ? 0 : 1;
 }